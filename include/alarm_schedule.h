@@ -0,0 +1,64 @@
+#ifndef ALARM_SCHEDULE_H
+#define ALARM_SCHEDULE_H
+
+#include <Arduino.h>
+
+// ==================== ALARM SCHEDULE ====================
+// LEARNING NOTE: The old checkAlarm() compared every alarm with the clock
+// on every loop pass and only matched at second 0 - if loop() happened to
+// be busy during that second, the dose was silently skipped.
+//
+// AlarmIndex works out once *when* the next alarm is due (and which
+// alarms share that minute). Each loop pass is then a single comparison
+// "now >= next?". Because it compares against a time instead of waiting
+// for an exact second, a late loop pass still fires the alarm.
+//
+// Times are "minutes since 2000-01-01 00:00" (DateTime::secondstime() / 60).
+
+#define MAX_ALARMS 16
+#define ALL_DAYS 0x7F // bit 0 = Sunday ... bit 6 = Saturday
+
+// An alarm that is up to this late still fires (e.g. the unit was busy
+// or switched on a few minutes after dose time). Older ones are skipped.
+#define ALARM_LATE_WINDOW_MIN 15
+
+// Alarm structure (compact to save RAM - 3 bytes)
+struct Alarm
+{
+  uint8_t hour;        // 0-23
+  uint8_t minute;      // 0-59
+  uint8_t days : 7;    // Days it rings on, bit 0 = Sunday
+  uint8_t enabled : 1;
+};
+
+class AlarmIndex
+{
+public:
+  AlarmIndex();
+
+  // Recalculate the next due time at or after 'fromMinute'. Call after
+  // any change to the alarms. Alarms already reported are not repeated.
+  void rebuild(const Alarm *alarms, uint8_t count, uint32_t fromMinute);
+
+  // Alarms that became due by 'nowMinute', as a bit mask (bit i = alarm i).
+  // Returns 0 in constant time when nothing is due.
+  uint16_t poll(const Alarm *alarms, uint8_t count, uint32_t nowMinute);
+
+  // Next due time and the alarms due then (mask 0 = no enabled alarms)
+  uint32_t nextMinute() const { return next; }
+  uint16_t nextMask() const { return mask; }
+
+private:
+  uint32_t next;
+  uint16_t mask;
+  uint32_t doneUntil; // Everything before this minute was already handled
+  uint32_t lastPoll;
+};
+
+// 0 = Sunday ... 6 = Saturday (2000-01-01 was a Saturday)
+inline uint8_t dayOfWeekOf(uint32_t minute)
+{
+  return (uint8_t)((minute / 1440 + 6) % 7);
+}
+
+#endif
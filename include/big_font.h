@@ -0,0 +1,34 @@
+#ifndef BIG_FONT_H
+#define BIG_FONT_H
+
+#include <Arduino.h>
+
+// ==================== PRECOMPUTED LARGE FONT ====================
+// LEARNING NOTE: Adafruit_GFX draws size 2 and 3 text one font pixel at a
+// time: every lit pixel of the 5x7 font becomes a 2x2 or 3x3 fillRect(),
+// each several calls deep. For the clock's eight characters that is about
+// 100 fillRect() calls a frame, every second.
+//
+// Here the scaled glyphs are worked out by the compiler (constexpr, see
+// big_font.cpp) and stored in Flash already in the SSD1306's layout: one
+// byte = 8 pixels of a column, top to bottom. Drawing a character is just
+// OR-ing 20 (size 2) or 45 (size 3) bytes into the framebuffer, shifted
+// when the text isn't on a multiple of 8 rows.
+//
+// Only the characters the screens print large are stored:
+//   size 2: digits : - ! space and A C D E F G H I K L M N O R S T V Y
+//           (the clock, MORNING/AFTERNOON/EVENING, DOSE TAKEN!, MISSED!,
+//           CANCELLED, SYSTEM ON, SAVED!, REFRESH)
+//   size 3: digits : - space (the hour/minute editor)
+// Anything else falls back to Adafruit_GFX.
+
+// True if c has a precomputed glyph at this text size
+bool bigFontHas(char c, uint8_t size);
+
+// OR the glyph for c into a framebuffer, top-left corner at (x, y), clipped
+// to 128 columns and to the pages buf holds: firstPage .. firstPage +
+// pages - 1, 128 bytes each. False (nothing drawn) if bigFontHas() is false.
+bool bigFontDraw(uint8_t *buf, uint8_t firstPage, uint8_t pages,
+                 int16_t x, int16_t y, char c, uint8_t size);
+
+#endif
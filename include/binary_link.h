@@ -0,0 +1,77 @@
+#ifndef BINARY_LINK_H
+#define BINARY_LINK_H
+
+#include <Arduino.h>
+
+// ==================== BINARY PROTOCOL ====================
+// LEARNING NOTE: The text protocol is easy to type but wordy, and a
+// corrupted byte just turns into a wrong number. Binary mode sends small
+// fixed-layout frames instead:
+//
+//   [reqId][opcode][payload...][crc16 lo][crc16 hi]    (request)
+//   [reqId][opcode][status][payload...][crc16 lo][crc16 hi]  (reply)
+//
+// Each frame is COBS-encoded (so it never contains 0x00) and ends with a
+// 0x00 byte. After line noise the receiver simply waits for the next 0x00
+// and is back in sync. The CRC is CRC-16/CCITT over everything before it.
+// Replies carry the request's reqId, so the host can send several requests
+// without waiting and match the replies up afterwards.
+
+#define BIN_FRAME_MAX 64 // Largest decoded frame, CRC included
+
+// Unsolicited frames (pushed events, see event_stream.h) use this opcode
+// and reqId 0: [0][BIN_OP_EVENT][BIN_OK][payload...][crc]
+#define BIN_OP_EVENT 0x80
+
+// Reply status codes
+#define BIN_OK 0
+#define BIN_ERR_UNKNOWN_COMMAND 1
+#define BIN_ERR_INVALID_PARAMS 2
+#define BIN_ERR_BAD_CRC 3
+#define BIN_ERR_BAD_LENGTH 4
+
+// Fills resp/respLen (up to BIN_PAYLOAD_MAX bytes) and returns a status
+#define BIN_PAYLOAD_MAX (BIN_FRAME_MAX - 5)
+typedef uint8_t (*BinaryHandler)(const uint8_t *req, uint8_t *resp, uint8_t &respLen);
+
+// One row of the opcode table - keep the table in PROGMEM
+struct BinaryCommandEntry
+{
+  uint8_t opcode;
+  uint8_t reqLen; // Exact request payload length
+  BinaryHandler handler;
+};
+
+class BinaryLink
+{
+public:
+  BinaryLink(const BinaryCommandEntry *table, uint8_t count);
+
+  void begin(); // Switch the link into binary mode
+  void end();   // Back to text mode (after the current reply)
+  bool active() const { return enabled; }
+
+  // Consume one received byte; replies go to 'out' when a frame completes.
+  // True if that frame passed the CRC check.
+  bool feed(uint8_t c, Print &out);
+
+  // Send a frame nobody asked for (reqId 0, BIN_OP_EVENT)
+  void sendEvent(Print &out, const uint8_t *payload, uint8_t len)
+  {
+    sendReply(out, 0, BIN_OP_EVENT, BIN_OK, payload, len);
+  }
+
+private:
+  bool handleFrame(Print &out);
+  void sendReply(Print &out, uint8_t reqId, uint8_t opcode, uint8_t status,
+                 const uint8_t *payload, uint8_t len);
+
+  const BinaryCommandEntry *table;
+  uint8_t count;
+  uint8_t rx[BIN_FRAME_MAX + 2]; // COBS adds at most 2 bytes at this size
+  uint8_t rxLen;
+  bool overflow;
+  bool enabled;
+};
+
+#endif
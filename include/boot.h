@@ -0,0 +1,41 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <Arduino.h>
+
+// ==================== FAST BOOT + WATCHDOG ====================
+// LEARNING NOTE: setup() used to sleep 3.5 s in fixed delays - half a
+// second around Serial and the I2C bus, two seconds on the splash screen -
+// whether the parts needed it or not. With FAST_BOOT each I2C device is
+// polled until it answers (bootWaitFor()) and used right away, so the
+// board is up in a few tens of milliseconds.
+//
+// That matters most when the board did not mean to restart. With WATCHDOG
+// on, loop() has to come round at least every HAL_WATCHDOG_MS or the
+// hardware resets it; a hang (a stuck I2C bus, a runaway loop) becomes a
+// reset instead of a dead reminder. The active reminder is checkpointed
+// in EEPROM (see main.cpp), so after the reset it picks up where it was -
+// same dose, same phase, same beeps - instead of being lost.
+//
+// Build with -D FAST_BOOT=0 for the old delays, -D WATCHDOG=0 to leave
+// the watchdog off (e.g. while stepping through in a debugger).
+
+#ifndef FAST_BOOT
+#define FAST_BOOT 1
+#endif
+
+#ifndef WATCHDOG
+#define WATCHDOG 1
+#endif
+
+// Longest bootWaitFor() waits for a device before going on without it
+#define BOOT_DEVICE_WAIT_MS 500
+
+// Poll the I2C address until the device answers. False on a timeout.
+// Without FAST_BOOT: the old fixed `fallbackMs` delay instead.
+bool bootWaitFor(uint8_t addr, unsigned long fallbackMs);
+
+// halDelay(ms) without FAST_BOOT, nothing with it
+void bootPause(unsigned long ms);
+
+#endif
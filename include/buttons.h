@@ -0,0 +1,74 @@
+#ifndef BUTTONS_H
+#define BUTTONS_H
+
+#include <Arduino.h>
+
+// ==================== INTERRUPT-DRIVEN BUTTONS ====================
+// LEARNING NOTE: btnPressed() used to poll with digitalRead(), wait 20 ms,
+// then spin until the button was released - holding a button froze
+// everything. Now every button pin raises a pin-change interrupt. The ISR
+// only writes (button, level, time) into a small ring buffer; loop() reads
+// the ring, debounces by timestamp and gets PRESS / RELEASE / LONG_PRESS
+// events. Nothing ever waits for a button.
+//
+// The ring has exactly one writer (the ISR) and one reader (loop()), each
+// owning one index, so no interrupts need to be disabled to use it.
+
+enum ButtonId
+{
+  BTN_UP,
+  BTN_DOWN,
+  BTN_SET,
+  BTN_CONFIRM,
+  BTN_HOME,
+  BTN_POWER, // Slide switch: "pressed" = LOW = OFF position
+  BTN_COUNT
+};
+
+enum ButtonEventType
+{
+  BTN_EVENT_PRESS,
+  BTN_EVENT_RELEASE,
+  BTN_EVENT_LONG_PRESS // Still held after BUTTON_LONG_PRESS_MS
+};
+
+struct ButtonEvent
+{
+  uint8_t button; // ButtonId
+  uint8_t type;   // ButtonEventType
+  uint16_t time;  // millis() of the edge (low 16 bits)
+};
+
+#define BUTTON_DEBOUNCE_MS 30
+#define BUTTON_LONG_PRESS_MS 1000
+
+// pins[] is indexed by ButtonId. All pins are active LOW.
+void buttonsBegin(const uint8_t *pins);
+
+// Next debounced event, if any. Call from loop() only.
+bool buttonsNextEvent(ButtonEvent &ev);
+
+// Debounced level of a button/switch (HIGH or LOW)
+uint8_t buttonLevel(uint8_t button);
+
+// A raw edge is waiting for buttonsNextEvent() - worth waking up for
+bool buttonsPending();
+
+// True while an edge is still queued or a pin has not settled yet. Sleeping
+// in power-down stops millis(), so the debouncer needs us awake until then.
+bool buttonsBusy();
+
+// ---- RTC 1 Hz square wave ----
+// The DS1307 SQW output shares the A0-A5 pin-change vector with HOME and
+// the power switch, so the same ISR counts its falling edges (one per
+// second, on the RTC's own seconds boundary). SQW is open drain - the pin
+// gets the internal pull-up.
+void rtcTickBegin(uint8_t pin);
+
+// Falling edges seen so far (wraps)
+uint8_t rtcTickCount();
+
+// millis() of the last falling edge - the moment the RTC's seconds advanced
+unsigned long rtcTickTime();
+
+#endif
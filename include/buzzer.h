@@ -0,0 +1,62 @@
+#ifndef BUZZER_H
+#define BUZZER_H
+
+#include <Arduino.h>
+
+// ==================== BUZZER PATTERNS ====================
+// LEARNING NOTE: Beeps used to be timed by loop(): HIGH, wait, LOW. A pass
+// that ran long (a screen redraw, a burst of serial commands) made the
+// beep longer or skipped it, and the buzzer test held the whole loop in
+// delay(). Now a beep sequence is a pattern in a PROGMEM table and a
+// Timer2 interrupt plays it, one step per timeout, to the millisecond.
+// loop() only says which pattern to start (or to stop) and moves on.
+//
+// A pattern is a list of step lengths, alternately ON and OFF, starting
+// with ON (0 = skip the step). After the last step it jumps back to
+// `repeatFrom` until the steps from there on have played `repeats` times
+// (0 = forever), then continues with pattern `next`, if any.
+//
+// Timer0 runs millis(), so the patterns use Timer2 (free here - only
+// tone() and PWM on pins 3/11 would want it): CTC mode, 1 kHz, interrupt
+// only while a pattern is playing. Host builds have no timer interrupt -
+// the pattern is brought up to date from millis() whenever a buzzer
+// function is called, with step edges at exact multiples of the step
+// lengths.
+
+enum BuzzerPattern
+{
+  BUZZ_URGENT,  // Reminder, first minute: 200 ms every second, then BUZZ_SNOOZE
+  BUZZ_SNOOZE,  // Reminder, after that: 100 ms every 2 minutes
+  BUZZ_CONFIRM, // Dose taken: a 50 ms beep, then a 150 ms one
+  BUZZ_TEST,    // CONFIRM on the clock screen: three 300 ms beeps
+  BUZZ_PATTERN_COUNT,
+  BUZZ_NONE = 0xFF
+};
+
+// Step lengths are in units of BUZZER_UNIT_MS, so 2 minutes fit in 16 bits
+#define BUZZER_UNIT_MS 10
+#define BUZZER_MAX_STEPS 4
+
+// How long BUZZ_URGENT plays before it turns into BUZZ_SNOOZE
+#define BUZZER_URGENT_MS 60000UL
+
+void buzzerBegin(uint8_t pin);
+
+// Start a pattern, replacing whatever was playing. skipMs: start that far
+// into it, as if it had been playing all along (a resumed reminder).
+void buzzerPlay(uint8_t pattern, uint32_t skipMs = 0);
+
+// Silence the buzzer and stop the pattern
+void buzzerStop();
+
+// The pattern playing now (after any `next` hand-over), or BUZZ_NONE
+uint8_t buzzerPattern();
+
+// True while a pattern is playing. Power-down would stop Timer2, so the
+// caller stays in idle sleep until this is false.
+bool buzzerBusy();
+
+// True while the buzzer is sounding
+bool buzzerOn();
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef COMMAND_READER_H
+#define COMMAND_READER_H
+
+#include <Arduino.h>
+
+// ==================== SERIAL COMMAND READER ====================
+// LEARNING NOTE: Serial.readStringUntil() waits up to 1 second for the rest
+// of a line and builds a String on the heap. CommandReader instead copies
+// whatever bytes have arrived into a fixed buffer and returns straight away.
+// When a '\n' arrives the line is split on ':' in place (the colons become
+// '\0') and the command name is looked up in a table stored in Flash.
+
+#define CMD_LINE_MAX 48 // Longest accepted line, without the '\n'
+#define CMD_MAX_ARGS 12 // Command name + parameters
+#define CMD_NAME_MAX 16 // Longest command name + '\0'
+
+// argv[0] is the command name, argv[1..argc-1] are the parameters
+typedef void (*CommandHandler)(uint8_t argc, char **argv);
+
+// One row of the command table - keep the table in PROGMEM
+struct CommandEntry
+{
+  char name[CMD_NAME_MAX];
+  CommandHandler handler;
+};
+
+class CommandReader
+{
+public:
+  CommandReader(const CommandEntry *table, uint8_t count);
+
+  // Consume one byte; runs the command when it completes a line. True if
+  // a known command ran (even one that rejected its parameters).
+  bool feed(uint8_t c);
+
+  // Drop a partially received line
+  void reset();
+
+private:
+  bool dispatch();
+
+  const CommandEntry *table;
+  uint8_t count;
+  char line[CMD_LINE_MAX + 1];
+  uint8_t len;
+  bool overflow; // Line too long - skip to the next '\n'
+};
+
+// Strict decimal parse: digits only, 0-255. Returns false otherwise.
+bool parseUint8(const char *s, uint8_t &out);
+
+// Same, 0-65535
+bool parseUint16(const char *s, uint16_t &out);
+
+// Same, 0-4294967295
+bool parseUint32(const char *s, uint32_t &out);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+
+// ==================== WEAR-LEVELED EEPROM STORE ====================
+// LEARNING NOTE: An EEPROM cell survives about 100,000 writes. Writing the
+// alarms to the same 9 bytes after every change wears those cells out.
+// ConfigStore keeps a ring of fixed-size slots instead; each save goes to
+// the next slot:
+//
+//   [version][seq lo][seq hi][len][payload ...][crc lo][crc hi]
+//
+// At boot every slot is checked and the valid one with the highest
+// sequence number wins. If power fails in the middle of a write, that
+// slot's CRC is wrong and the previous record is used. Saving data that
+// hasn't changed writes nothing, and halEepromUpdate() skips bytes that
+// already hold the right value.
+
+#define CONFIG_SLOT_OVERHEAD 6 // Header + CRC bytes per slot
+
+class ConfigStore
+{
+public:
+  ConfigStore(uint16_t base, uint8_t slotSize, uint8_t slotCount, uint8_t version);
+
+  // Copy the newest valid record into data. False if there is none, or
+  // its version/length doesn't match.
+  bool load(void *data, uint8_t len);
+
+  // Write data as the newest record (nothing is written if unchanged)
+  void save(const void *data, uint8_t len);
+
+  // Sequence number of the newest record (0 = none). It changes with
+  // every save that writes something, so it doubles as a version of the
+  // stored data.
+  uint16_t sequence() const { return seq; }
+
+  // Bytes of EEPROM used: base .. base + size() - 1
+  uint16_t size() const { return (uint16_t)slotSize * slotCount; }
+
+private:
+  uint16_t slotAddr(uint8_t slot) const { return base + (uint16_t)slot * slotSize; }
+  bool slotValid(uint8_t slot, uint16_t &seq, uint8_t &len) const;
+
+  uint16_t base;
+  uint8_t slotSize;
+  uint8_t slotCount;
+  uint8_t version;
+  int8_t current; // Slot of the newest record, -1 = none
+  uint16_t seq;   // Its sequence number
+};
+
+#endif
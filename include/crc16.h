@@ -0,0 +1,30 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+#if defined(__AVR__)
+#include <util/crc16.h>
+#endif
+
+// CRC-16/CCITT (polynomial 0x1021), one byte at a time.
+// On AVR this is avr-libc's hand-written assembly version.
+static inline uint16_t crc16Update(uint16_t crc, uint8_t data)
+{
+#if defined(__AVR__)
+  return _crc_ccitt_update(crc, data);
+#else
+  data ^= (uint8_t)(crc & 0xFF);
+  data ^= (uint8_t)(data << 4);
+  return (uint16_t)((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+#endif
+}
+
+static inline uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc = 0xFFFF)
+{
+  while (len--)
+    crc = crc16Update(crc, *data++);
+  return crc;
+}
+
+#endif
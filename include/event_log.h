@@ -0,0 +1,77 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+
+// ==================== ADHERENCE EVENT LOG ====================
+// LEARNING NOTE: "Dose taken" used to be just a line on the serial port -
+// if the dashboard wasn't listening, it was gone. Now every outcome is
+// also written to EEPROM, numbered, so the dashboard can ask "what
+// happened after event 41?" (GET_LOG:41) whenever it reconnects.
+//
+// To fit months of events into 512 bytes, the log is a ring of blocks:
+//
+//   Block:  [magic][first seq lo][first seq hi][time x4][record][record]...
+//   Record: [type | delta << 3]([delta varint])[lag]
+//
+// - time is minutes since 2000-01-01. Each record only stores the minutes
+//   since the previous event (delta), which is usually under 31 and then
+//   fits in the same byte as the type. A typical record is 2 bytes.
+// - lag: minutes from the dose time to the event (taken 3 min late = 3)
+// - Unwritten EEPROM reads 0xFF, which marks the end of a block. A record
+//   is written back to front, so its first byte only appears once the
+//   whole record is there - a power cut mid-write loses just that event.
+// - When the last block fills, the oldest block is wiped and reused.
+
+enum LogEventType
+{
+  EVT_TAKEN = 1,     // Confirmed in the first minute
+  EVT_LATE = 2,      // Confirmed during the snooze phase
+  EVT_MISSED = 3,    // Not confirmed within 15 minutes
+  EVT_CANCELLED = 4, // Switched off while the reminder was running
+};
+
+struct LogEvent
+{
+  uint16_t seq;    // 1, 2, 3 ... (wraps after 65535)
+  uint8_t type;    // LogEventType
+  uint8_t lag;     // Minutes after the dose time
+  uint32_t minute; // Minutes since 2000-01-01
+};
+
+#define EVENT_LOG_BLOCK_SIZE 64
+#define EVENT_LOG_HEADER 7
+
+class EventLog
+{
+public:
+  EventLog(uint16_t base, uint8_t blockCount);
+
+  // Find the newest block and where to append. Call once at startup.
+  void begin();
+
+  void append(uint8_t type, uint32_t minute, uint8_t lag);
+
+  // Events after `since` (0 = all), oldest first, at most `max` of them.
+  // more = there are further events after the last one returned.
+  uint8_t read(uint16_t since, LogEvent *out, uint8_t max, bool &more) const;
+
+  // Sequence number of the newest event (0 = none yet)
+  uint16_t lastSeq() const { return nextSeq - 1; }
+
+private:
+  uint16_t blockAddr(uint8_t b) const { return base + (uint16_t)b * EVENT_LOG_BLOCK_SIZE; }
+  bool blockValid(uint8_t b, uint16_t &seq, uint32_t &minute) const;
+  // Decode the record at pos; false at the end of the block
+  bool readRecord(uint8_t b, uint8_t &pos, uint8_t &type, uint32_t &delta, uint8_t &lag) const;
+  void startBlock(uint32_t minute);
+
+  uint16_t base;
+  uint8_t blockCount;
+  int8_t current;      // Block being appended to, -1 = log empty
+  uint8_t writePos;    // Offset of the next record in that block
+  uint16_t nextSeq;
+  uint32_t lastMinute; // Time of the newest event
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include "binary_link.h"
+#include "serial_out.h"
+
+// ==================== PUSHED EVENTS ====================
+// LEARNING NOTE: The dashboard bridge used to send GET_STATUS and
+// GET_ALARMS over and over just to notice that something changed. After
+// SUBSCRIBE the Arduino tells it instead, one line per change:
+//
+//   EVT:17:TAKEN:8:0        (sequence number, type, values)
+//
+// In binary mode the same event is a frame with reqId 0 and opcode
+// BIN_OP_EVENT: [seq lo][seq hi][type][values...].
+//
+// Every event gets the next sequence number, even while nobody is
+// subscribed. A gap in the numbers tells the host it missed something
+// and should re-read the state (GET_SCHEDULE, GET_LOG).
+
+enum PushEventType
+{
+  PUSH_POWER,         // on (0/1)
+  PUSH_ALARM,         // hour, minute - reminder started
+  PUSH_TAKEN,         // hour, minute
+  PUSH_LATE,          // hour, minute
+  PUSH_MISSED,        // hour, minute
+  PUSH_CANCELLED,     // hour, minute
+  PUSH_ALARM_SET,     // index, hour, minute
+  PUSH_ALARM_ENABLED, // index, enabled
+  PUSH_ALARM_DAYS,    // index, days
+  PUSH_ALARM_DELETED, // index, new count
+  PUSH_SCHEDULE,      // count - replaced as a whole (batch upload)
+  PUSH_TYPE_COUNT
+};
+
+class EventStream
+{
+public:
+  EventStream(BinaryLink &link, SerialOut &out);
+
+  void subscribe(bool on) { enabled = on; }
+  bool subscribed() const { return enabled; }
+
+  // Sequence number of the newest event (0 = none yet)
+  uint16_t lastSeq() const { return seq; }
+
+  // Number the event and queue it as one unit if subscribed. Unused values
+  // are ignored (each type has a fixed count, see the table in
+  // event_stream.cpp).
+  void push(uint8_t type, uint8_t a = 0, uint8_t b = 0, uint8_t c = 0);
+
+private:
+  BinaryLink &link;
+  SerialOut &out;
+  uint16_t seq;
+  bool enabled;
+};
+
+#endif
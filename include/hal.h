@@ -0,0 +1,81 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <Arduino.h>
+
+// ==================== HARDWARE ABSTRACTION ====================
+// LEARNING NOTE: The firmware logic (menus, alarms, reminders, serial
+// protocol) never talks to the hardware directly - only through the
+// functions below. There are two implementations:
+//
+//   src/hal_avr.cpp      - the real board (Arduino core, TWI driver, EEPROM)
+//   src/native/          - a Linux build ([env:native] in platformio.ini)
+//                          with a virtual clock. Sleeping and delay() just
+//                          move the clock forward, so days of alarms run
+//                          in well under a second.
+//
+// Serial is the one exception: the code keeps using `Serial` (a Print /
+// Stream). On the host it is stdin/stdout, see src/native/Arduino.h.
+
+// ---- Time ----
+unsigned long halMillis();
+unsigned long halMicros();
+void halDelay(unsigned long ms);
+
+// ---- GPIO ----
+void halPinMode(uint8_t pin, uint8_t mode);
+void halDigitalWrite(uint8_t pin, uint8_t level);
+uint8_t halDigitalRead(uint8_t pin);
+
+// ---- Sleep (see power.h) ----
+// Idle: wake on the next interrupt, or by untilMs at the latest (the
+// AVR's millis() interrupt comes every 1 ms anyway).
+void halSleepIdle(unsigned long untilMs);
+// Power-down: wake on a pin change. Returns true if the RX line woke us.
+bool halSleepPowerDown();
+
+// ---- I2C bus + RTC (DS1307) ----
+void halI2cBegin();
+// True if a device answers (ACKs) at the 7-bit address
+bool halI2cProbe(uint8_t addr);
+// Starts the RTC, setting it to the build time if it was stopped.
+// False if the RTC doesn't answer.
+bool halRtcBegin();
+// Seconds since 2000-01-01 (DateTime::secondstime()) into t. False, and
+// t left alone, if the RTC didn't answer.
+bool halRtcRead(uint32_t &t);
+// 1 Hz square wave on SQW/OUT
+void halRtcSquareWave();
+
+// ---- EEPROM ----
+#define HAL_EEPROM_SIZE 1024
+uint8_t halEepromRead(uint16_t addr);
+// Only writes if the byte differs (EEPROM.update())
+void halEepromUpdate(uint16_t addr, uint8_t value);
+
+// ---- Reset cause + watchdog ----
+// Why the board last reset: the AVR's MCUSR bits, saved before setup()
+#define HAL_RESET_POWER_ON 0x01
+#define HAL_RESET_EXTERNAL 0x02
+#define HAL_RESET_BROWNOUT 0x04
+#define HAL_RESET_WATCHDOG 0x08
+uint8_t halResetFlags();
+// From now on the board resets unless halWatchdogKick() comes at least
+// every HAL_WATCHDOG_MS. halSleepPowerDown() pauses it (nothing runs to
+// kick it there).
+#define HAL_WATCHDOG_MS 4000
+void halWatchdogBegin();
+void halWatchdogKick();
+
+// ---- Display sink ----
+// AVR: the SSD1306 (oled.h). Host: a text grid the simulator can print.
+// Both take Adafruit_GFX style calls: setCursor, setTextSize, print, flush.
+#ifdef ARDUINO
+#include "oled.h"
+typedef Oled Display;
+#else
+#include "display_sink.h"
+typedef DisplaySink Display;
+#endif
+
+#endif
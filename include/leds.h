@@ -0,0 +1,38 @@
+#ifndef LEDS_H
+#define LEDS_H
+
+#include <Arduino.h>
+
+// ==================== DAY LEDS ====================
+// LEARNING NOTE: Every pass of loop() used to switch all seven LEDs off
+// with digitalWrite() and then today's back on - eight pin-table lookups
+// every 100 ms for a picture that changes once a day. Now loop() only
+// says which LEDs should be on and which should blink. The driver keeps
+// the bitmask that is on the pins and touches the hardware only when it
+// changes, with one masked write per port register (pins 2-7 are PORTD,
+// pin 8 is PORTB) instead of one digitalWrite() per LED.
+//
+// Blinking runs off Timer0's compare B interrupt, which comes once per
+// millis() tick (1.024 ms) without changing Timer0 - so the rhythm holds
+// even while loop() is busy drawing or answering serial commands. The
+// interrupt is only on while something blinks. (Pin 5 is OC0B, but
+// without analogWrite() the compare never reaches the pin.)
+//
+// Host builds have no timer interrupt: the blink phase is worked out from
+// millis() whenever a leds function is called.
+
+#define LED_COUNT 7
+#define LED_ALL ((1 << LED_COUNT) - 1)
+#define LED_BLINK_MS 500 // On for this long, then off for this long
+
+// pins[] has LED_COUNT entries, bit i of a mask is pins[i]. All LEDs off.
+void ledsBegin(const uint8_t *pins);
+
+// LEDs in `steady` are on, LEDs in `blinking` blink. A new blinking mask
+// starts with the LEDs on; passing the same masks again changes nothing.
+void ledsShow(uint8_t steady, uint8_t blinking = 0);
+
+// The bitmask on the pins right now
+uint8_t ledsLit();
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+
+// ==================== LOGGING ====================
+// LEARNING NOTE: At 9600 baud the UART moves about 960 bytes per second.
+// Debug prints used to eat most of that and, once the 64-byte TX buffer
+// was full, every Serial.print() waited - delaying replies to the website.
+//
+// - Levels are chosen at compile time (LOG_LEVEL in platformio.ini).
+//   A disabled LOG_xxx() line compiles to nothing: no code, no Flash string.
+// - Each message belongs to a class with its own minimum interval, so a
+//   chatty class can't flood the link. Skipped lines are counted and the
+//   count is shown on the next line that gets through.
+// - Log lines start with "# " so the website can tell them apart from
+//   protocol replies. They queue behind replies and events (serial_out.h)
+//   and only if there is room right now. When the link is busy a log line
+//   is dropped, never waited on, and counted like a rate-limited one.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Log lines go through serialOut's diagnostics queue. Define LOG_PORT
+// (-D LOG_PORT=Serial1) to write them to a second UART on boards that
+// have one instead.
+
+enum LogClass
+{
+  LOG_SYSTEM, // Boot, power switch
+  LOG_ALARM,  // Reminder start/snooze/result
+  LOG_BUTTON, // Button presses
+  LOG_LED,    // Day LED updates
+  LOG_MENU,   // Menu actions
+  LOG_BUZZER, // Buzzer test
+  LOG_CLASS_COUNT
+};
+
+// printf() format for a string stored in Flash
+#if defined(__AVR__)
+#define LOG_PSTR "%S"
+#else
+#define LOG_PSTR "%s"
+#endif
+
+// fmt must be a PSTR() - use the LOG_xxx() macros below
+void logWrite(uint8_t cls, const char *fmt, ...);
+
+// Lines dropped because the TX buffer was full / rate limited
+extern uint16_t logDroppedBusy;
+extern uint16_t logDroppedRate;
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(cls, fmt, ...) logWrite(cls, PSTR("E " fmt), ##__VA_ARGS__)
+#else
+#define LOG_ERROR(cls, fmt, ...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(cls, fmt, ...) logWrite(cls, PSTR("W " fmt), ##__VA_ARGS__)
+#else
+#define LOG_WARN(cls, fmt, ...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(cls, fmt, ...) logWrite(cls, PSTR("I " fmt), ##__VA_ARGS__)
+#else
+#define LOG_INFO(cls, fmt, ...) do { } while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(cls, fmt, ...) logWrite(cls, PSTR("D " fmt), ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(cls, fmt, ...) do { } while (0)
+#endif
+
+#endif
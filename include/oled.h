@@ -0,0 +1,159 @@
+#ifndef OLED_H
+#define OLED_H
+
+#include <Adafruit_GFX.h>
+#include "twi.h"
+
+// ==================== DIRTY-REGION OLED ====================
+// LEARNING NOTE: Adafruit's display() pushes the whole 1 KB framebuffer over
+// I2C every time, even if only the seconds digits changed.
+// Oled::flush() splits the screen into 8 pages x 8 chunks of 16 columns,
+// keeps a CRC of each chunk as it was last sent, and only sends the chunks
+// whose CRC changed. Screen code draws exactly like before and calls
+// flush() instead of display().
+//
+// The panel is driven through twi.h, not Adafruit_SSD1306 (which needs
+// Wire): each page that changed is one queued transaction - the window
+// commands, then its dirty columns - and flush() returns while the last
+// pages are still going out.
+//
+// Size 2 and 3 text goes through the precomputed glyphs in big_font.h
+// where there is one, instead of Adafruit_GFX's pixel-by-pixel drawChar().
+//
+// ---- Page mode (OLED_PAGE_MODE=1) ----
+// The 1 KB framebuffer is half of the Uno's 2 KB RAM. In page mode there is
+// none: between clearDisplay() and flush() the text calls (setCursor,
+// setTextSize, setTextColor, print) are only recorded in a short draw
+// list. flush() then plays the list back 8 times, once per 8-row page,
+// into a 128-byte page buffer - everything outside that page is clipped -
+// and queues the page's changed chunks before moving on to the next. Two
+// page buffers take turns, so one page renders while the other is sent.
+// Screens must therefore be text only and fit OLED_DRAW_LIST_MAX bytes;
+// anything after that is dropped.
+
+// Build with -D OLED_PAGE_MODE=1 to render a page at a time
+#ifndef OLED_PAGE_MODE
+#define OLED_PAGE_MODE 0
+#endif
+
+#define OLED_CHUNK_COLS 16
+#define OLED_CHUNKS_PER_PAGE (128 / OLED_CHUNK_COLS)
+#define OLED_PAGES (64 / 8)
+#define OLED_DRAW_LIST_MAX 160 // Longest screen (SELECT DOSE menu) is ~140
+
+#if OLED_PAGE_MODE
+#define OLED_TXNS 2          // One per page buffer
+#else
+#define OLED_TXNS OLED_PAGES // One per page of the framebuffer
+#endif
+
+// The SSD1306 commands and colours used here and by the screens (same
+// names and values as Adafruit_SSD1306.h)
+#define SSD1306_BLACK 0
+#define SSD1306_WHITE 1
+#define SSD1306_INVERSE 2
+#define SSD1306_EXTERNALVCC 0x01
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_MEMORYMODE 0x20
+#define SSD1306_COLUMNADDR 0x21
+#define SSD1306_PAGEADDR 0x22
+#define SSD1306_DEACTIVATE_SCROLL 0x2E
+#define SSD1306_SETSTARTLINE 0x40
+#define SSD1306_SETCONTRAST 0x81
+#define SSD1306_CHARGEPUMP 0x8D
+#define SSD1306_SEGREMAP 0xA0
+#define SSD1306_DISPLAYALLON_RESUME 0xA4
+#define SSD1306_NORMALDISPLAY 0xA6
+#define SSD1306_SETMULTIPLEX 0xA8
+#define SSD1306_DISPLAYOFF 0xAE
+#define SSD1306_DISPLAYON 0xAF
+#define SSD1306_COMSCANDEC 0xC8
+#define SSD1306_SETDISPLAYOFFSET 0xD3
+#define SSD1306_SETDISPLAYCLOCKDIV 0xD5
+#define SSD1306_SETPRECHARGE 0xD9
+#define SSD1306_SETCOMPINS 0xDA
+#define SSD1306_SETVCOMDETECT 0xDB
+
+class Oled : public Adafruit_GFX
+{
+public:
+  Oled(uint8_t w, uint8_t h);
+
+  // Sends the init sequence (and allocates the framebuffer, if there is
+  // one). Needs halI2cBegin() first.
+  bool begin(uint8_t vcc, uint8_t addr);
+
+  // Starts a frame (and the render timer)
+  void clearDisplay();
+
+  // Text, with the big font shortcut
+  size_t write(uint8_t c);
+  using Print::write;
+
+  // Into the framebuffer, or (page mode) clipped to the page being
+  // rendered. No rotation.
+  void drawPixel(int16_t x, int16_t y, uint16_t color);
+
+#if OLED_PAGE_MODE
+  // Recorded in the draw list as well
+  void setCursor(int16_t x, int16_t y);
+  void setTextSize(uint8_t size);
+  void setTextColor(uint16_t color);
+#endif
+
+  // Queue only what changed since the last flush()
+  void flush();
+
+  // Forget what the panel shows - the next flush() sends everything
+  void invalidate();
+
+  // RAM the picture takes: the framebuffer, or page buffers + draw list
+  uint16_t ramBytes() const;
+
+  // I2C bytes per second over the last second: actually sent, and what
+  // a full display() on every flush() would have cost
+  uint32_t sentPerSec;
+  uint32_t fullPerSec;
+
+  // Microseconds spent drawing the last frame, without the I2C traffic
+  // (framebuffer mode: clearDisplay() to flush(); page mode: recording
+  // plus the 8 playbacks)
+  uint32_t renderUs;
+
+private:
+  void putChar(uint8_t c);
+  void sendPage(uint8_t page, const uint8_t *row, TwiTxn &txn);
+  void reclaim(TwiTxn &txn);
+
+  uint8_t i2caddr;
+  uint8_t vccstate;
+  TwiTxn txns[OLED_TXNS];
+  uint16_t chunkCrc[OLED_PAGES][OLED_CHUNKS_PER_PAGE];
+  bool fullRefresh;
+  bool resend; // A page transaction failed - send everything next flush()
+  uint32_t bytesSent;
+  uint32_t bytesFull;
+  unsigned long statsStart;
+  unsigned long frameStart;
+
+#if OLED_PAGE_MODE
+  void record(uint8_t b);
+  void renderPage(uint8_t page);
+
+  uint8_t pageBufs[OLED_TXNS][128];
+  uint8_t *pageBuf; // The one being rendered
+  uint8_t drawList[OLED_DRAW_LIST_MAX];
+  uint8_t listLen;
+  int8_t rasterPage; // Page being played back, -1 = recording
+
+  // Text state at clearDisplay() - where playback starts from
+  int16_t startX;
+  int16_t startY;
+  uint8_t startSize;
+  uint16_t startColor;
+#else
+  uint8_t *buffer;
+#endif
+};
+
+#endif
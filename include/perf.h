@@ -0,0 +1,106 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <Arduino.h>
+
+// ==================== PERFORMANCE COUNTERS ====================
+// LEARNING NOTE: Without counters all we know from the field is "it feels
+// slow". These are cheap enough to leave on in normal builds (a couple of
+// micros() calls per section, ~70 bytes of RAM) and GET_PERF reads them:
+//
+//   - Loop histogram: how long each loop() pass ran before going back to
+//     sleep, in PERF_BUCKETS buckets (limits in perf.cpp). Anything in
+//     the top buckets is a stall worth finding.
+//   - Sections: average and longest time of serial handling, screen
+//     drawing, I2C traffic (OLED + RTC) and the alarm check.
+//   - RX backlog: most bytes found waiting in Serial's 64-byte RX buffer.
+//     64 means the buffer filled and bytes were probably lost.
+//   - Stack: at reset the free RAM between the heap and the stack is
+//     painted with a marker byte. Bytes still holding it were never used,
+//     so that is the headroom the deepest call chain so far has left.
+//   - Free RAM now, and the least seen when a section ended.
+//
+// Counters halve instead of overflowing, so averages and the histogram
+// keep their shape. RESET_PERF starts over (and repaints the stack).
+//
+// Build with -D PERF_STATS=0 ([env:uno_release]) to compile all of it out:
+// the PERF_xxx() macros become nothing and GET_PERF / RESET_PERF are
+// unknown commands.
+
+#ifndef PERF_STATS
+#define PERF_STATS 1
+#endif
+
+enum PerfSection
+{
+  PERF_SERIAL, // handleSerialCommands()
+  PERF_RENDER, // Drawing a frame (Oled::renderUs)
+  PERF_I2C,    // OLED updates and RTC reads on the bus
+  PERF_ALARM,  // checkAlarms()
+  PERF_SECTION_COUNT
+};
+
+#define PERF_BUCKETS 10
+
+#if PERF_STATS
+
+struct PerfSectionStats
+{
+  uint16_t count;
+  uint32_t totalUs;
+  uint32_t maxUs;
+
+  // Average, capped at 65535
+  uint16_t avgUs() const;
+};
+
+struct PerfStats
+{
+  uint16_t loopHist[PERF_BUCKETS];
+  PerfSectionStats sections[PERF_SECTION_COUNT];
+  uint8_t rxPeak;
+  uint16_t minFreeRam;
+};
+
+extern PerfStats perf;
+
+void perfAdd(uint8_t section, uint32_t us);
+void perfLoopStart();
+void perfLoopEnd();
+void perfRxBacklog(uint8_t waiting);
+void perfReset();
+
+// Bytes between the heap and the stack right now / never touched since
+// the last paint. Both 0 on the host build.
+uint16_t perfFreeRam();
+uint16_t perfStackUnused();
+
+// Times the rest of the enclosing block
+class PerfTimer
+{
+public:
+  PerfTimer(uint8_t section);
+  ~PerfTimer();
+
+private:
+  uint8_t section;
+  unsigned long start;
+};
+
+#define PERF_SCOPE(section) PerfTimer perfTimer_(section)
+#define PERF_ADD(section, us) perfAdd(section, us)
+#define PERF_LOOP_START() perfLoopStart()
+#define PERF_LOOP_END() perfLoopEnd()
+#define PERF_RX_BACKLOG(waiting) perfRxBacklog(waiting)
+
+#else
+
+#define PERF_SCOPE(section)
+#define PERF_ADD(section, us) do { } while (0)
+#define PERF_LOOP_START() do { } while (0)
+#define PERF_LOOP_END() do { } while (0)
+#define PERF_RX_BACKLOG(waiting) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+// ==================== LOW-POWER SLEEP ====================
+// LEARNING NOTE: loop() used to end in delay(100) - the CPU spun at full
+// power ten times a second, even with the unit switched off. Now it sleeps
+// until something happens:
+//
+//   powerIdle()  - CPU clock stops, timers and UART keep running. The next
+//                  interrupt (at the latest the 1 ms millis() tick) wakes it.
+//   powerDown()  - Everything stops, millis() too. Only a pin change wakes
+//                  it: a button, the power switch, the RTC's 1 Hz square
+//                  wave or a start bit on the RX pin.
+//
+// Power-down needs the crystal to restart (about 1 ms), which is about one
+// byte at 9600 baud - the byte that woke us is usually lost. Hosts should
+// send a newline before the first command after a quiet spell.
+
+// Build with -D LOW_POWER=0 to go back to a plain delay() between passes
+#ifndef LOW_POWER
+#define LOW_POWER 1
+#endif
+
+void powerBegin();
+
+// Sleep until the next interrupt, timers running. untilMs: the caller
+// wants to be back by then (host builds jump straight there).
+void powerIdle(unsigned long untilMs);
+
+// Sleep until a pin changes. Returns true if the RX line woke us.
+bool powerDown();
+
+// ---- Awake duty cycle ----
+// Awake time = micros() that passed outside powerIdle(). micros() stops in
+// power-down, so the window length comes from RTC ticks when there are any.
+struct PowerStats
+{
+  uint16_t awakePermille; // Share of the window the CPU was running
+  uint16_t seconds;       // Window length
+  uint16_t downSleeps;    // powerDown() calls in the window
+};
+
+// rtcTicks: RTC seconds counted during the window (0 if SQW is missing).
+// Starts a new window.
+void powerTakeStats(uint16_t rtcTicks, PowerStats &stats);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SERIAL_OUT_H
+#define SERIAL_OUT_H
+
+#include <Arduino.h>
+
+// ==================== SERIAL OUTPUT QUEUE ====================
+// LEARNING NOTE: A reply is built from many small print() calls. Sent
+// straight to Serial, every one of them waited once the UART's 64-byte TX
+// buffer was full - a GET_SCHEDULE reply at 9600 baud held loop() for
+// over 100 ms. serialOut sits in between:
+//
+//   - Replies and events are printed into a queue as one unit, between
+//     begin() and end(). Only end() hands the unit to the sender, so a
+//     half-built reply never goes out with a log line in the middle.
+//   - service() (every loop() pass, and on every wake while idling) moves
+//     queued bytes into Serial only as far as its TX buffer has room right
+//     now. Nothing waits for the UART.
+//   - Replies and events go ahead of diagnostics. Log lines have a small
+//     queue of their own; a line that doesn't fit is dropped, and the next
+//     line of its class says how many went missing (see log.h).
+//   - Backpressure: handleSerialCommands() stops reading commands while
+//     room() is below SEROUT_REPLY_ROOM. The host's next request waits in
+//     the RX buffer instead of loop() waiting on the UART.
+//
+// SEROUT_REPLY_ROOM is the longest reply there is: GET_SNAPSHOT with
+// MAX_ALARMS alarms, 221 bytes (GET_SCHEDULE 202, a full GET_LOG 170).
+// So any command's reply fits the queue whole. Only a unit longer than
+// the free queue plus the TX buffer would still wait, and `stalls` counts
+// how often that happened - it should stay 0.
+
+#define SEROUT_QUEUE_SIZE 240 // Replies and events (head/count are uint8_t)
+#define SEROUT_DIAG_SIZE 64   // Log lines (one LOG_LINE_MAX line)
+#define SEROUT_REPLY_ROOM 224 // Free queue needed before the next command
+
+class SerialOut : public Print
+{
+public:
+  SerialOut();
+
+  // Open / close a unit (a reply or an event). Pairs nest: an event pushed
+  // while a command runs becomes part of that command's unit.
+  void begin();
+  void end();
+
+  // Into the open unit. Outside begin()/end() each byte is a unit.
+  size_t write(uint8_t c);
+  using Print::write;
+
+  // Queue one whole diagnostic line. False (not queued) if it doesn't fit
+  // right now.
+  bool writeDiag(const uint8_t *line, uint8_t len);
+
+  // Hand queued bytes to Serial while its TX buffer has room
+  void service();
+
+  // Queue bytes free for replies and events
+  uint16_t room() const { return SEROUT_QUEUE_SIZE - count - open; }
+
+  // Wait until everything is sent - before a baud change or power-down
+  void drain();
+
+  uint16_t stalls; // Units that had to wait for the UART
+
+private:
+  bool take(uint8_t &c);
+  uint16_t wrap(uint16_t i) const { return i % SEROUT_QUEUE_SIZE; }
+
+  uint8_t queue[SEROUT_QUEUE_SIZE];
+  uint8_t head;  // Next byte to send
+  uint8_t count; // Closed bytes waiting to be sent
+  uint8_t open;  // Bytes of the unit being printed, behind those
+  uint8_t depth; // begin() calls not yet ended
+
+  uint8_t diag[SEROUT_DIAG_SIZE];
+  uint8_t diagHead;
+  uint8_t diagCount;
+  bool diagMid; // Part way through sending a log line
+};
+
+extern SerialOut serialOut;
+
+#endif
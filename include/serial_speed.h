@@ -0,0 +1,64 @@
+#ifndef SERIAL_SPEED_H
+#define SERIAL_SPEED_H
+
+#include <Arduino.h>
+
+// ==================== SERIAL SPEED NEGOTIATION ====================
+// LEARNING NOTE: At 9600 baud a GET_ALARMS + GET_STATUS round trip spends
+// most of its time on the wire. The host can ask for a faster rate:
+//
+//   host:   SET_BAUD:115200          (at the old rate)
+//   device: OK:BAUD:115200           (still at the old rate, then switches)
+//   host:   switches too, sends any command at the new rate
+//
+// If the host never gets the reply, the two ends now talk past each other.
+// So a new rate starts "on probation": unless a valid command or binary
+// frame arrives within BAUD_CONFIRM_MS, the device drops back to 9600.
+// Only a confirmed rate is worth remembering in EEPROM; at boot it is on
+// probation again, for longer, since a host may not be connected yet.
+
+#define BAUD_DEFAULT 9600
+#define BAUD_CONFIRM_MS 3000       // After SET_BAUD
+#define BAUD_BOOT_CONFIRM_MS 10000 // After reset at a remembered rate
+
+// One of 9600, 19200, 38400, 57600, 115200, 250000 (250000 is exact on a
+// 16 MHz AVR, 115200 is 2 % off but within what UARTs tolerate)
+bool baudSupported(uint32_t rate);
+
+class SerialSpeed
+{
+public:
+  SerialSpeed();
+
+  // Open Serial at the remembered rate (BAUD_DEFAULT if unsupported)
+  void begin(uint32_t remembered);
+
+  // Switch after the reply to the current command has gone out
+  void request(uint32_t rate) { next = rate; }
+
+  // Call after each received byte is handled. Does the switch a request()
+  // asked for; true if it did, so the caller can drop half-read input.
+  bool apply();
+
+  // A valid command or frame arrived at the current rate. True if that
+  // ended a probation - the caller should remember the rate now.
+  bool confirm();
+
+  // Call every loop() pass. True if probation ran out and the rate just
+  // went back to BAUD_DEFAULT.
+  bool poll();
+
+  uint32_t rate() const { return current; }
+  bool onProbation() const { return probation; }
+
+private:
+  void open(uint32_t rate, unsigned long confirmMs);
+
+  uint32_t current;
+  uint32_t next; // 0 = no switch requested
+  bool probation;
+  unsigned long since;
+  unsigned long window;
+};
+
+#endif
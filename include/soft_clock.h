@@ -0,0 +1,82 @@
+#ifndef SOFT_CLOCK_H
+#define SOFT_CLOCK_H
+
+#include <Arduino.h>
+
+// ==================== SOFTWARE CLOCK ====================
+// LEARNING NOTE: rtc.now() is an I2C transaction plus BCD decoding, and
+// loop() used to call it on every pass although the time only changes
+// once a second. SoftClock remembers one RTC reading and the millis() it
+// belongs to, and works the time out from millis() after that. The RTC is
+// read again every few minutes (and after sleeping, when millis() stood
+// still) to pull the clock back in line.
+//
+// Each resync also measures how far millis() has wandered from the RTC.
+// When both readings were taken right on the RTC's 1 Hz tick, that error
+// is exact to the millisecond and gives the drift in ppm (16 MHz ceramic
+// resonators are typically a few hundred ppm out).
+//
+// Times are seconds since 2000-01-01, like DateTime::secondstime().
+
+#define SOFT_CLOCK_SYNC_MINUTES 10 // Default resync interval
+
+// Unix time of 2000-01-01 00:00:00 - add it to get Unix seconds for hosts
+#define CLOCK_UNIX_2000 946684800UL
+
+// Time of day from seconds since 2000, with the same method names as
+// RTClib's DateTime (which the screens used before). No date - nothing
+// here needs one, and it keeps this to a few divisions.
+class ClockTime
+{
+public:
+  explicit ClockTime(uint32_t seconds) : s(seconds) {}
+  uint8_t hour() const { return (s / 3600UL) % 24; }
+  uint8_t minute() const { return (s / 60UL) % 60; }
+  uint8_t second() const { return s % 60UL; }
+  uint8_t dayOfTheWeek() const { return (s / 86400UL + 6) % 7; } // 2000-01-01 was a Saturday
+  uint32_t secondstime() const { return s; }
+
+private:
+  uint32_t s;
+};
+
+class SoftClock
+{
+public:
+  SoftClock();
+
+  // The RTC read `seconds` and that second began at millis() `atMs`.
+  // aligned: atMs is the RTC tick itself, not just some time in that second.
+  void sync(uint32_t seconds, unsigned long atMs, bool aligned);
+
+  // Current time. Never goes backwards by a small resync correction.
+  uint32_t now();
+
+  // The RTC didn't answer: keep counting from the last good reading and
+  // try again after the interval
+  void syncFailed();
+
+  // True if the interval has passed or requestSync() was called
+  bool needsSync() const;
+  void requestSync() { pending = true; }
+  bool synced() const { return syncCount != 0; }
+
+  void setInterval(uint8_t minutes) { intervalMinutes = minutes; }
+  uint8_t interval() const { return intervalMinutes; }
+
+  // ---- Drift tracking (see GET_CLOCK) ----
+  int32_t lastErrorMs; // Soft clock minus RTC at the last resync (+ = ran fast)
+  int32_t driftPpm;    // From the last two aligned resyncs, 0 if unknown
+  uint16_t syncCount;
+
+private:
+  uint32_t baseSeconds;
+  unsigned long baseMs;
+  unsigned long lastSyncMs;
+  uint32_t floorSeconds; // now() doesn't go below this (see sync())
+  bool baseAligned;
+  bool pending;
+  uint8_t intervalMinutes;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef TWI_H
+#define TWI_H
+
+#include <Arduino.h>
+
+// ==================== INTERRUPT-DRIVEN I2C ====================
+// LEARNING NOTE: Wire sends at 100 kHz and waits for every byte: a flush()
+// that changed the whole screen kept the CPU spinning for ~25 ms, and an
+// RTC read that came along meanwhile waited behind it. This driver owns
+// the TWI hardware instead (Wire, Adafruit's display code and RTClib are
+// no longer linked - two TWI interrupt handlers can't coexist):
+//
+//   - The bus runs at 400 kHz (the SSD1306 and DS1307 both allow it).
+//   - Callers fill in a TwiTxn - bytes to write, then optionally bytes to
+//     read after a repeated start - and queue it with twiSubmit(). The TWI
+//     interrupt moves it along byte by byte while loop() carries on.
+//   - status says how it went (poll it, or twiWait() for it), and onDone,
+//     if set, is called from the interrupt when it finishes.
+//   - An urgent transaction (the RTC read) goes straight behind the one on
+//     the bus, so it waits for at most one OLED page, never a whole frame.
+//
+// A TwiTxn and the buffers it points to belong to the driver until its
+// status is final - don't change or reuse them before that.
+
+#define TWI_FREQ 400000UL
+#define TWI_HEAD_MAX 13    // An OLED page address sequence (see oled.cpp)
+#define TWI_TIMEOUT_MS 50  // twiWait() gives up and resets the bus
+
+enum TwiStatus
+{
+  TWI_DONE,   // Finished OK (also the state of a new TwiTxn)
+  TWI_QUEUED,
+  TWI_ACTIVE, // On the bus now
+  TWI_NACK,   // The device didn't answer or refused a byte
+  TWI_ERROR   // Bus error, lost arbitration or twiWait() timed out
+};
+
+struct TwiTxn
+{
+  uint8_t addr;               // 7-bit address
+  uint8_t headLen;
+  uint8_t head[TWI_HEAD_MAX]; // Written first: register number, commands
+  const uint8_t *data;        // Then dataLen bytes from here
+  uint8_t dataLen;
+  uint8_t *readBuf;           // Then a repeated start and readLen bytes
+  uint8_t readLen;            // read into here
+  volatile uint8_t status;    // TwiStatus
+  void (*onDone)(TwiTxn &txn); // From the interrupt, may be NULL
+  TwiTxn *next;               // The driver's queue link
+};
+
+void twiBegin();
+
+// Queue txn. urgent: ahead of everything not started yet. False (and
+// nothing queued) if txn is still queued or on the bus.
+bool twiSubmit(TwiTxn &txn, bool urgent = false);
+
+// Queued or on the bus
+inline bool twiPending(const TwiTxn &txn)
+{
+  return txn.status == TWI_QUEUED || txn.status == TWI_ACTIVE;
+}
+
+// Anything queued or on the bus
+bool twiBusy();
+
+// Spin until txn is finished and return its status. After TWI_TIMEOUT_MS
+// the hardware is reset and everything pending ends with TWI_ERROR.
+uint8_t twiWait(TwiTxn &txn);
+
+// Transactions that ended in TWI_NACK or TWI_ERROR since twiBegin()
+uint16_t twiErrors();
+
+#endif
@@ -0,0 +1,74 @@
+#include "alarm_schedule.h"
+
+#define MINUTES_PER_DAY 1440UL
+
+AlarmIndex::AlarmIndex() : next(0), mask(0), doneUntil(0), lastPoll(0)
+{
+}
+
+void AlarmIndex::rebuild(const Alarm *alarms, uint8_t count, uint32_t fromMinute)
+{
+  if (fromMinute < doneUntil)
+    fromMinute = doneUntil;
+
+  uint32_t dayStart = fromMinute - fromMinute % MINUTES_PER_DAY;
+  uint8_t dow = dayOfWeekOf(fromMinute);
+
+  mask = 0;
+  next = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (!alarms[i].enabled || !alarms[i].days)
+      continue;
+
+    // First matching day within the next 8 days (today may be too late)
+    uint16_t timeOfDay = alarms[i].hour * 60 + alarms[i].minute;
+    for (uint8_t d = 0; d < 8; d++)
+    {
+      if (!(alarms[i].days & (1 << ((dow + d) % 7))))
+        continue;
+      uint32_t t = dayStart + d * MINUTES_PER_DAY + timeOfDay;
+      if (t < fromMinute)
+        continue;
+
+      if (mask == 0 || t < next)
+      {
+        next = t;
+        mask = (1U << i);
+      }
+      else if (t == next)
+      {
+        mask |= (1U << i);
+      }
+      break;
+    }
+  }
+}
+
+uint16_t AlarmIndex::poll(const Alarm *alarms, uint8_t count, uint32_t nowMinute)
+{
+  // Clock set backwards - start over from the new time
+  if (nowMinute + 1 < lastPoll)
+  {
+    doneUntil = 0;
+    rebuild(alarms, count, nowMinute);
+  }
+  lastPoll = nowMinute;
+
+  uint16_t due = 0;
+  while (mask && next <= nowMinute)
+  {
+    if (nowMinute - next <= ALARM_LATE_WINDOW_MIN)
+    {
+      due |= mask;
+      doneUntil = next + 1;
+    }
+    else
+    {
+      // Far too late (unit was off) - don't ring for it now
+      doneUntil = nowMinute - ALARM_LATE_WINDOW_MIN;
+    }
+    rebuild(alarms, count, doneUntil);
+  }
+  return due;
+}
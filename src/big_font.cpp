@@ -0,0 +1,204 @@
+#include "big_font.h"
+
+// ---- Source font (compile time only) ----
+// The 5x7 Adafruit_GFX font for the characters we keep: 5 columns per
+// character, bit 0 = top row. It is only read by the constexpr functions
+// below, so it never ends up in the firmware itself.
+#define BIG_FONT_SOURCE_CHARS " !-:0123456789ACDEFGHIKLMNORSTVY"
+#define BIG_FONT_SIZE2_CHARS BIG_FONT_SOURCE_CHARS
+#define BIG_FONT_SIZE3_CHARS " -:0123456789"
+
+constexpr uint8_t sourceFont[][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x00, 0x00, 0x5F, 0x00, 0x00}, // !
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // -
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // :
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // 0
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // 1
+    {0x72, 0x49, 0x49, 0x49, 0x46}, // 2
+    {0x21, 0x41, 0x49, 0x4D, 0x33}, // 3
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // 4
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
+    {0x3C, 0x4A, 0x49, 0x49, 0x31}, // 6
+    {0x41, 0x21, 0x11, 0x09, 0x07}, // 7
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
+    {0x46, 0x49, 0x49, 0x29, 0x1E}, // 9
+    {0x7C, 0x12, 0x11, 0x12, 0x7C}, // A
+    {0x3E, 0x41, 0x41, 0x41, 0x22}, // C
+    {0x7F, 0x41, 0x41, 0x41, 0x3E}, // D
+    {0x7F, 0x49, 0x49, 0x49, 0x41}, // E
+    {0x7F, 0x09, 0x09, 0x09, 0x01}, // F
+    {0x3E, 0x41, 0x41, 0x51, 0x73}, // G
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, // H
+    {0x00, 0x41, 0x7F, 0x41, 0x00}, // I
+    {0x7F, 0x08, 0x14, 0x22, 0x41}, // K
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, // L
+    {0x7F, 0x02, 0x1C, 0x02, 0x7F}, // M
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, // N
+    {0x3E, 0x41, 0x41, 0x41, 0x3E}, // O
+    {0x7F, 0x09, 0x19, 0x29, 0x46}, // R
+    {0x26, 0x49, 0x49, 0x49, 0x32}, // S
+    {0x03, 0x01, 0x7F, 0x01, 0x03}, // T
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, // V
+    {0x03, 0x04, 0x78, 0x04, 0x03}, // Y
+};
+
+// ---- Scaling, worked out by the compiler ----
+constexpr unsigned indexOf(const char *chars, char c, unsigned i = 0)
+{
+  return chars[i] == c ? i : indexOf(chars, c, i + 1);
+}
+
+// Scaled row y of a source column (each source row becomes `size` rows)
+constexpr uint8_t pixel(uint8_t column, unsigned y, unsigned size)
+{
+  return (column >> (y / size)) & 1;
+}
+
+// One framebuffer byte: rows page*8 .. page*8+7 of a scaled column
+constexpr uint8_t scaledByte(uint8_t column, unsigned page, unsigned size)
+{
+  return pixel(column, page * 8 + 0, size) | pixel(column, page * 8 + 1, size) << 1 |
+         pixel(column, page * 8 + 2, size) << 2 | pixel(column, page * 8 + 3, size) << 3 |
+         pixel(column, page * 8 + 4, size) << 4 | pixel(column, page * 8 + 5, size) << 5 |
+         pixel(column, page * 8 + 6, size) << 6 | pixel(column, page * 8 + 7, size) << 7;
+}
+
+// Per glyph: 5 * size columns (the blank 6th is never drawn), each
+// `size` bytes from the top page down
+constexpr unsigned glyphBytes(unsigned size)
+{
+  return 5 * size * size;
+}
+
+// Byte i of the table for the characters in `chars` at `size`
+constexpr uint8_t tableByte(const char *chars, unsigned size, unsigned i)
+{
+  return scaledByte(sourceFont[indexOf(BIG_FONT_SOURCE_CHARS, chars[i / glyphBytes(size)])]
+                              [i % glyphBytes(size) / size / size],
+                    i % size, size);
+}
+
+// 0, 1, ... N-1 as a template parameter pack (log depth, so the compiler's
+// recursion limit is no issue)
+template <unsigned... I>
+struct Seq
+{
+};
+
+template <class A, class B>
+struct SeqCat;
+
+template <unsigned... A, unsigned... B>
+struct SeqCat<Seq<A...>, Seq<B...> >
+{
+  typedef Seq<A..., (sizeof...(A) + B)...> type;
+};
+
+template <unsigned N>
+struct MakeSeq
+{
+  typedef typename SeqCat<typename MakeSeq<N / 2>::type, typename MakeSeq<N - N / 2>::type>::type type;
+};
+
+template <>
+struct MakeSeq<0>
+{
+  typedef Seq<> type;
+};
+
+template <>
+struct MakeSeq<1>
+{
+  typedef Seq<0> type;
+};
+
+template <unsigned N>
+struct GlyphTable
+{
+  uint8_t bytes[N];
+};
+
+template <unsigned SIZE, unsigned... I>
+constexpr GlyphTable<sizeof...(I)> expand(const char *chars, Seq<I...>)
+{
+  return GlyphTable<sizeof...(I)>{{tableByte(chars, SIZE, I)...}};
+}
+
+#define SIZE2_BYTES ((sizeof(BIG_FONT_SIZE2_CHARS) - 1) * glyphBytes(2))
+#define SIZE3_BYTES ((sizeof(BIG_FONT_SIZE3_CHARS) - 1) * glyphBytes(3))
+
+// ---- The tables (in Flash) ----
+static const char size2Chars[] PROGMEM = BIG_FONT_SIZE2_CHARS;
+static const char size3Chars[] PROGMEM = BIG_FONT_SIZE3_CHARS;
+
+static const GlyphTable<SIZE2_BYTES> size2Glyphs PROGMEM =
+    expand<2>(BIG_FONT_SIZE2_CHARS, MakeSeq<SIZE2_BYTES>::type());
+static const GlyphTable<SIZE3_BYTES> size3Glyphs PROGMEM =
+    expand<3>(BIG_FONT_SIZE3_CHARS, MakeSeq<SIZE3_BYTES>::type());
+
+static const uint8_t *glyphFor(char c, uint8_t size)
+{
+  const char *chars;
+  const uint8_t *table;
+  if (size == 2)
+  {
+    chars = size2Chars;
+    table = size2Glyphs.bytes;
+  }
+  else if (size == 3)
+  {
+    chars = size3Chars;
+    table = size3Glyphs.bytes;
+  }
+  else
+  {
+    return NULL;
+  }
+
+  for (uint8_t g = 0;; g++)
+  {
+    char k = pgm_read_byte(chars + g);
+    if (k == '\0')
+      return NULL;
+    if (k == c)
+      return table + g * glyphBytes(size);
+  }
+}
+
+bool bigFontHas(char c, uint8_t size)
+{
+  return glyphFor(c, size) != NULL;
+}
+
+bool bigFontDraw(uint8_t *buf, uint8_t firstPage, uint8_t pages,
+                 int16_t x, int16_t y, char c, uint8_t size)
+{
+  const uint8_t *glyph = glyphFor(c, size);
+  if (!glyph)
+    return false;
+
+  // A glyph row that isn't page aligned straddles two pages
+  uint8_t shift = y & 7;
+  int16_t topPage = (y >> 3) - firstPage; // >> rounds down, also above the screen
+
+  for (uint8_t col = 0; col < 5 * size; col++, glyph += size)
+  {
+    int16_t dx = x + col;
+    if (dx < 0 || dx >= 128)
+      continue;
+
+    for (uint8_t p = 0; p < size; p++)
+    {
+      uint8_t bits = pgm_read_byte(glyph + p);
+      if (bits == 0)
+        continue;
+      int16_t page = topPage + p;
+      if (page >= 0 && page < pages)
+        buf[page * 128 + dx] |= bits << shift;
+      if (shift && page + 1 >= 0 && page + 1 < pages)
+        buf[(page + 1) * 128 + dx] |= bits >> (8 - shift);
+    }
+  }
+  return true;
+}
@@ -0,0 +1,131 @@
+#include "binary_link.h"
+#include "crc16.h"
+
+BinaryLink::BinaryLink(const BinaryCommandEntry *table, uint8_t count)
+    : table(table), count(count), rxLen(0), overflow(false), enabled(false)
+{
+}
+
+void BinaryLink::begin()
+{
+  rxLen = 0;
+  overflow = false;
+  enabled = true;
+}
+
+void BinaryLink::end()
+{
+  enabled = false;
+}
+
+bool BinaryLink::feed(uint8_t c, Print &out)
+{
+  if (c == 0x00)
+  {
+    // End of frame
+    bool valid = false;
+    if (!overflow && rxLen > 0)
+      valid = handleFrame(out);
+    rxLen = 0;
+    overflow = false;
+    return valid;
+  }
+  else if (rxLen < sizeof(rx))
+  {
+    rx[rxLen++] = c;
+  }
+  else
+  {
+    overflow = true; // Garbage - wait for the next 0x00
+  }
+  return false;
+}
+
+// COBS-decode rx in place, check the CRC, run the handler and reply
+bool BinaryLink::handleFrame(Print &out)
+{
+  uint8_t len = 0;
+  uint8_t i = 0;
+  while (i < rxLen)
+  {
+    uint8_t code = rx[i++];
+    for (uint8_t j = 1; j < code; j++)
+    {
+      if (i >= rxLen)
+        return false; // Truncated block - drop the frame
+      rx[len++] = rx[i++];
+    }
+    if (code < 0xFF && i < rxLen)
+      rx[len++] = 0x00;
+  }
+
+  // reqId + opcode + CRC at least
+  if (len < 4)
+    return false;
+
+  uint8_t reqId = rx[0];
+  uint8_t opcode = rx[1];
+  uint16_t crc = rx[len - 2] | ((uint16_t)rx[len - 1] << 8);
+  if (crc16(rx, len - 2) != crc)
+  {
+    sendReply(out, reqId, opcode, BIN_ERR_BAD_CRC, 0, 0);
+    return false;
+  }
+
+  uint8_t reqLen = len - 4;
+  for (uint8_t k = 0; k < count; k++)
+  {
+    if (pgm_read_byte(&table[k].opcode) != opcode)
+      continue;
+
+    if (pgm_read_byte(&table[k].reqLen) != reqLen)
+    {
+      sendReply(out, reqId, opcode, BIN_ERR_BAD_LENGTH, 0, 0);
+      return true;
+    }
+
+    uint8_t resp[BIN_PAYLOAD_MAX];
+    uint8_t respLen = 0;
+    BinaryHandler handler = (BinaryHandler)pgm_read_ptr(&table[k].handler);
+    uint8_t status = handler(rx + 2, resp, respLen);
+    sendReply(out, reqId, opcode, status, resp, status == BIN_OK ? respLen : 0);
+    return true;
+  }
+
+  sendReply(out, reqId, opcode, BIN_ERR_UNKNOWN_COMMAND, 0, 0);
+  return true;
+}
+
+// Build the reply frame, then COBS-encode it straight onto the wire
+void BinaryLink::sendReply(Print &out, uint8_t reqId, uint8_t opcode, uint8_t status,
+                           const uint8_t *payload, uint8_t len)
+{
+  uint8_t frame[BIN_FRAME_MAX];
+  uint8_t n = 0;
+  frame[n++] = reqId;
+  frame[n++] = opcode;
+  frame[n++] = status;
+  for (uint8_t i = 0; i < len; i++)
+    frame[n++] = payload[i];
+  uint16_t crc = crc16(frame, n);
+  frame[n++] = crc & 0xFF;
+  frame[n++] = crc >> 8;
+
+  // Each block: [distance to next zero][non-zero bytes...]
+  uint8_t blockStart = 0;
+  while (blockStart <= n)
+  {
+    uint8_t end = blockStart;
+    while (end < n && frame[end] != 0x00 && end - blockStart < 254)
+      end++;
+
+    out.write((uint8_t)(end - blockStart + 1));
+    out.write(frame + blockStart, end - blockStart);
+
+    if (end - blockStart == 254 && end < n)
+      blockStart = end; // Full block, no zero was consumed
+    else
+      blockStart = end + 1;
+  }
+  out.write((uint8_t)0x00);
+}
@@ -0,0 +1,31 @@
+#include "boot.h"
+#include "hal.h"
+
+#define BOOT_POLL_MS 2 // Between probes of a device that isn't ready yet
+
+bool bootWaitFor(uint8_t addr, unsigned long fallbackMs)
+{
+#if FAST_BOOT
+  (void)fallbackMs;
+  unsigned long start = halMillis();
+  while (!halI2cProbe(addr))
+  {
+    if (halMillis() - start >= BOOT_DEVICE_WAIT_MS)
+      return false;
+    halDelay(BOOT_POLL_MS);
+  }
+  return true;
+#else
+  halDelay(fallbackMs);
+  return halI2cProbe(addr);
+#endif
+}
+
+void bootPause(unsigned long ms)
+{
+#if FAST_BOOT
+  (void)ms;
+#else
+  halDelay(ms);
+#endif
+}
@@ -0,0 +1,273 @@
+#include "buttons.h"
+#include "hal.h"
+
+// ---- ISR -> loop() ring buffer ----
+#define RAW_RING_SIZE 16 // Power of two
+
+struct RawEdge
+{
+  uint8_t button; // ButtonId, bit 7 = level
+  uint16_t time;
+};
+
+static volatile RawEdge rawRing[RAW_RING_SIZE];
+static volatile uint8_t rawHead = 0; // Written by the ISR only
+static volatile uint8_t rawTail = 0; // Written by loop() only
+
+// ---- Pin lookup, filled in by buttonsBegin() ----
+#ifdef __AVR__
+static volatile uint8_t *pinReg[BTN_COUNT];
+static uint8_t pinMask[BTN_COUNT];
+#else
+static uint8_t pinNum[BTN_COUNT];
+#endif
+static volatile uint8_t isrLevels = 0; // Last raw level seen by the ISR, bit per button
+
+// ---- RTC square wave, set up by rtcTickBegin() ----
+static bool tickWatched = false;
+#ifdef __AVR__
+static volatile uint8_t *tickReg = 0;
+static uint8_t tickMask = 0;
+#else
+static uint8_t tickPin = 0;
+#endif
+static volatile uint8_t tickLevel = 0;
+static volatile uint8_t tickCount = 0;
+static volatile unsigned long tickTime = 0;
+
+// ---- Debouncer state (loop() only) ----
+static uint8_t stableLevels = 0; // Debounced level, bit per button
+static uint16_t lastEdge[BTN_COUNT];   // Time of the last raw edge
+static uint16_t lastChange[BTN_COUNT]; // Time of the last accepted change
+static uint8_t longSent = 0;           // LONG_PRESS already reported, bit per button
+
+static inline uint8_t readRaw(uint8_t b)
+{
+#ifdef __AVR__
+  return (*pinReg[b] & pinMask[b]) ? 1 : 0;
+#else
+  return halDigitalRead(pinNum[b]) ? 1 : 0;
+#endif
+}
+
+static inline uint8_t readTick()
+{
+#ifdef __AVR__
+  return (*tickReg & tickMask) ? 1 : 0;
+#else
+  return halDigitalRead(tickPin) ? 1 : 0;
+#endif
+}
+
+// Shared by both pin-change vectors: push one entry per button that changed
+static void onPinChange()
+{
+  if (tickWatched)
+  {
+    uint8_t level = readTick();
+    if (!level && tickLevel)
+    {
+      tickCount++;
+      tickTime = halMillis();
+    }
+    tickLevel = level;
+  }
+
+  uint16_t t = (uint16_t)halMillis();
+  uint8_t levels = 0;
+  for (uint8_t b = 0; b < BTN_COUNT; b++)
+    if (readRaw(b))
+      levels |= (1 << b);
+
+  uint8_t changed = levels ^ isrLevels;
+  isrLevels = levels;
+
+  for (uint8_t b = 0; b < BTN_COUNT; b++)
+  {
+    if (!(changed & (1 << b)))
+      continue;
+
+    uint8_t next = (rawHead + 1) & (RAW_RING_SIZE - 1);
+    if (next == rawTail)
+      return; // Full - the settle check in buttonsNextEvent() repairs it
+    rawRing[rawHead].button = b | ((levels & (1 << b)) ? 0x80 : 0);
+    rawRing[rawHead].time = t;
+    rawHead = next;
+  }
+}
+
+#ifdef __AVR__
+ISR(PCINT0_vect) // D8-D13
+{
+  onPinChange();
+}
+
+ISR(PCINT1_vect) // A0-A5
+{
+  onPinChange();
+}
+#endif
+
+// Host builds have no pin-change interrupts - look at the pins whenever
+// loop() asks instead
+static inline void samplePins()
+{
+#ifndef __AVR__
+  onPinChange();
+#endif
+}
+
+static void enablePinChange(uint8_t pin)
+{
+#ifdef __AVR__
+  *digitalPinToPCMSK(pin) |= bit(digitalPinToPCMSKbit(pin));
+  PCICR |= bit(digitalPinToPCICRbit(pin));
+#endif
+}
+
+void buttonsBegin(const uint8_t *pins)
+{
+  uint16_t t = (uint16_t)halMillis();
+  for (uint8_t b = 0; b < BTN_COUNT; b++)
+  {
+    uint8_t pin = pins[b];
+    halPinMode(pin, INPUT);
+#ifdef __AVR__
+    pinReg[b] = portInputRegister(digitalPinToPort(pin));
+    pinMask[b] = digitalPinToBitMask(pin);
+#else
+    pinNum[b] = pin;
+#endif
+    if (readRaw(b))
+      stableLevels |= (1 << b);
+    lastEdge[b] = t;
+    lastChange[b] = t;
+    enablePinChange(pin);
+  }
+  isrLevels = stableLevels;
+}
+
+uint8_t buttonLevel(uint8_t button)
+{
+  return (stableLevels & (1 << button)) ? HIGH : LOW;
+}
+
+bool buttonsPending()
+{
+  samplePins();
+  return rawTail != rawHead;
+}
+
+bool buttonsBusy()
+{
+  samplePins();
+  if (rawTail != rawHead)
+    return true;
+  for (uint8_t b = 0; b < BTN_COUNT; b++)
+    if (readRaw(b) != ((stableLevels & (1 << b)) ? 1 : 0))
+      return true;
+  return false;
+}
+
+void rtcTickBegin(uint8_t pin)
+{
+  halPinMode(pin, INPUT_PULLUP);
+#ifdef __AVR__
+  uint8_t oldSREG = SREG;
+  cli();
+  tickReg = portInputRegister(digitalPinToPort(pin));
+  tickMask = digitalPinToBitMask(pin);
+#else
+  tickPin = pin;
+#endif
+  tickLevel = readTick();
+  tickWatched = true;
+#ifdef __AVR__
+  SREG = oldSREG;
+#endif
+  enablePinChange(pin);
+}
+
+uint8_t rtcTickCount()
+{
+  samplePins();
+  return tickCount; // Single byte - atomic to read
+}
+
+unsigned long rtcTickTime()
+{
+#ifdef __AVR__
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long t = tickTime;
+  SREG = oldSREG;
+  return t;
+#else
+  return tickTime;
+#endif
+}
+
+// Accept a new debounced level and describe it as an event
+static void accept(uint8_t b, uint8_t level, uint16_t t, ButtonEvent &ev)
+{
+  if (level)
+    stableLevels |= (1 << b);
+  else
+    stableLevels &= ~(1 << b);
+  lastChange[b] = t;
+  longSent &= ~(1 << b);
+
+  ev.button = b;
+  ev.type = level ? BTN_EVENT_RELEASE : BTN_EVENT_PRESS; // Active LOW
+  ev.time = t;
+}
+
+bool buttonsNextEvent(ButtonEvent &ev)
+{
+  samplePins();
+
+  // 1) Raw edges from the ISR. The first edge after a quiet period is
+  //    accepted straight away; bounces right after it are ignored.
+  while (rawTail != rawHead)
+  {
+    uint8_t b = rawRing[rawTail].button & 0x7F;
+    uint8_t level = (rawRing[rawTail].button & 0x80) ? 1 : 0;
+    uint16_t t = rawRing[rawTail].time;
+    rawTail = (rawTail + 1) & (RAW_RING_SIZE - 1);
+
+    lastEdge[b] = t;
+    uint8_t stable = (stableLevels & (1 << b)) ? 1 : 0;
+    if (level != stable && (uint16_t)(t - lastChange[b]) >= BUTTON_DEBOUNCE_MS)
+    {
+      accept(b, level, t, ev);
+      return true;
+    }
+  }
+
+  uint16_t now = (uint16_t)halMillis();
+  for (uint8_t b = 0; b < BTN_COUNT; b++)
+  {
+    // 2) Settle check: the pin has been quiet for the debounce time but
+    //    differs from what we reported (last edge fell inside a bounce)
+    uint8_t level = readRaw(b);
+    uint8_t stable = (stableLevels & (1 << b)) ? 1 : 0;
+    if (level != stable && (uint16_t)(now - lastEdge[b]) >= BUTTON_DEBOUNCE_MS)
+    {
+      accept(b, level, now, ev);
+      return true;
+    }
+
+    // 3) Long press (not for the slide switch)
+    if (b != BTN_POWER && !stable && !(longSent & (1 << b)) &&
+        (uint16_t)(now - lastChange[b]) >= BUTTON_LONG_PRESS_MS)
+    {
+      longSent |= (1 << b);
+      ev.button = b;
+      ev.type = BTN_EVENT_LONG_PRESS;
+      ev.time = now;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,210 @@
+#include "buzzer.h"
+#include "hal.h"
+
+// ---- Pattern table ----
+struct PatternDef
+{
+  uint8_t count;      // Steps used
+  uint8_t repeatFrom; // Step to jump back to after the last one
+  uint8_t repeats;    // Plays of steps repeatFrom..count-1, 0 = forever
+  uint8_t next;       // BuzzerPattern to continue with, or BUZZ_NONE
+  uint16_t steps[BUZZER_MAX_STEPS]; // BUZZER_UNIT_MS units: ON, OFF, ON, OFF
+};
+
+static const PatternDef patterns[BUZZ_PATTERN_COUNT] PROGMEM = {
+  // BUZZ_URGENT: 200 on / 800 off, 60 times = BUZZER_URGENT_MS
+  {2, 0, BUZZER_URGENT_MS / 1000, BUZZ_SNOOZE, {20, 80, 0, 0}},
+  // BUZZ_SNOOZE: quiet until 2 minutes after the alarm, then 100 ms
+  // every 2 minutes
+  {4, 2, 0, BUZZ_NONE, {0, 6000, 10, 11990}},
+  // BUZZ_CONFIRM: 50 on / 50 off / 150 on - a short beep, then a longer
+  // one (one pitch: the pin is only switched on and off)
+  {3, 0, 1, BUZZ_NONE, {5, 5, 15, 0}},
+  // BUZZ_TEST: 300 on / 300 off, 3 times
+  {2, 0, 3, BUZZ_NONE, {30, 30, 0, 0}}
+};
+
+// ---- Player state (the ISR's while a pattern plays) ----
+static volatile uint8_t current = BUZZ_NONE;
+static volatile bool sounding = false;
+static uint8_t step;   // Index into steps[]
+static uint8_t played; // Passes through the repeated part so far
+
+#ifdef __AVR__
+static volatile uint8_t *outReg = 0;
+static uint8_t outMask = 0;
+static volatile uint16_t unitsLeft; // Of the current step
+static volatile uint8_t msLeft;     // Of the current unit
+#else
+static uint8_t outPin = 0;
+static unsigned long stepEnd; // millis() the current step ends
+#endif
+
+static void setOutput(bool on)
+{
+  sounding = on;
+#ifdef __AVR__
+  if (outReg)
+  {
+    if (on)
+      *outReg |= outMask;
+    else
+      *outReg &= ~outMask;
+  }
+#else
+  halDigitalWrite(outPin, on ? HIGH : LOW);
+#endif
+}
+
+// Move on to the next step that has a length and set the pin for it.
+// Returns that length in units, or 0 if the pattern is over.
+static uint16_t advance()
+{
+  for (;;)
+  {
+    const PatternDef *p = &patterns[current];
+    step++;
+    if (step >= pgm_read_byte(&p->count))
+    {
+      played++;
+      uint8_t repeats = pgm_read_byte(&p->repeats);
+      if (repeats == 0 || played < repeats)
+      {
+        step = pgm_read_byte(&p->repeatFrom);
+      }
+      else
+      {
+        uint8_t next = pgm_read_byte(&p->next);
+        if (next == BUZZ_NONE)
+        {
+          current = BUZZ_NONE;
+          setOutput(false);
+          return 0;
+        }
+        current = next;
+        p = &patterns[next];
+        step = 0;
+        played = 0;
+      }
+    }
+
+    uint16_t length = pgm_read_word(&p->steps[step]);
+    if (length)
+    {
+      setOutput(!(step & 1)); // Even steps are ON
+      return length;
+    }
+  }
+}
+
+#ifdef __AVR__
+// 1 kHz while a pattern plays
+ISR(TIMER2_COMPA_vect)
+{
+  if (--msLeft)
+    return;
+  msLeft = BUZZER_UNIT_MS;
+  if (--unitsLeft)
+    return;
+  unitsLeft = advance();
+  if (!unitsLeft)
+    TIMSK2 &= ~bit(OCIE2A);
+}
+#endif
+
+// Host builds have no timer interrupt - play the steps that are due now
+static void catchUp()
+{
+#ifndef __AVR__
+  unsigned long t = halMillis();
+  while (current != BUZZ_NONE && (long)(t - stepEnd) >= 0)
+    stepEnd += (unsigned long)advance() * BUZZER_UNIT_MS;
+#endif
+}
+
+void buzzerBegin(uint8_t pin)
+{
+  halPinMode(pin, OUTPUT);
+#ifdef __AVR__
+  outReg = portOutputRegister(digitalPinToPort(pin));
+  outMask = digitalPinToBitMask(pin);
+
+  // Timer2: CTC, clk/64, compare match every 1 ms. The interrupt itself is
+  // only enabled by buzzerPlay().
+  TIMSK2 = 0;
+  TCCR2A = bit(WGM21);
+  TCCR2B = bit(CS22);
+  OCR2A = F_CPU / 64 / 1000 - 1;
+#else
+  outPin = pin;
+#endif
+  setOutput(false);
+}
+
+void buzzerPlay(uint8_t pattern, uint32_t skipMs)
+{
+  if (pattern >= BUZZ_PATTERN_COUNT)
+    return;
+
+#ifdef __AVR__
+  uint8_t oldSREG = SREG;
+  cli();
+#endif
+  current = pattern;
+  step = 0xFF; // advance() wraps it to the first step
+  played = 0;
+
+  // Fast-forward whole steps, then start part way into the current one
+  uint16_t units = advance();
+  uint32_t skip = skipMs / BUZZER_UNIT_MS;
+  while (units && skip >= units)
+  {
+    skip -= units;
+    units = advance();
+  }
+  if (units)
+    units -= skip;
+
+#ifdef __AVR__
+  unitsLeft = units;
+  msLeft = BUZZER_UNIT_MS;
+  TCNT2 = 0;
+  TIFR2 = bit(OCF2A); // Start a whole millisecond from now
+  if (units)
+    TIMSK2 |= bit(OCIE2A);
+  SREG = oldSREG;
+#else
+  stepEnd = halMillis() + (unsigned long)units * BUZZER_UNIT_MS;
+#endif
+}
+
+void buzzerStop()
+{
+#ifdef __AVR__
+  uint8_t oldSREG = SREG;
+  cli();
+  TIMSK2 &= ~bit(OCIE2A);
+#endif
+  current = BUZZ_NONE;
+  setOutput(false);
+#ifdef __AVR__
+  SREG = oldSREG;
+#endif
+}
+
+uint8_t buzzerPattern()
+{
+  catchUp();
+  return current; // Single byte - atomic to read
+}
+
+bool buzzerBusy()
+{
+  return buzzerPattern() != BUZZ_NONE;
+}
+
+bool buzzerOn()
+{
+  catchUp();
+  return sounding;
+}
@@ -0,0 +1,139 @@
+#include "command_reader.h"
+#include "serial_out.h"
+
+CommandReader::CommandReader(const CommandEntry *table, uint8_t count)
+    : table(table), count(count), len(0), overflow(false)
+{
+}
+
+void CommandReader::reset()
+{
+  len = 0;
+  overflow = false;
+}
+
+bool CommandReader::feed(uint8_t c)
+{
+  if (c == '\n')
+  {
+    bool ran = false;
+    if (overflow)
+      serialOut.println(F("ERROR:LINE_TOO_LONG"));
+    else
+      ran = dispatch();
+    reset();
+    return ran;
+  }
+
+  if (c == '\r' || overflow)
+    return false;
+
+  if (len >= CMD_LINE_MAX)
+  {
+    overflow = true;
+    return false;
+  }
+
+  line[len++] = (char)c;
+  return false;
+}
+
+bool CommandReader::dispatch()
+{
+  // Trim whitespace at both ends
+  while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t'))
+    len--;
+  line[len] = '\0';
+
+  char *p = line;
+  while (*p == ' ' || *p == '\t')
+    p++;
+  if (*p == '\0')
+    return false; // Blank line
+
+  // Split on ':' in place
+  char *argv[CMD_MAX_ARGS];
+  uint8_t argc = 0;
+  argv[argc++] = p;
+  for (; *p; p++)
+  {
+    if (*p == ':')
+    {
+      *p = '\0';
+      if (argc == CMD_MAX_ARGS)
+      {
+        serialOut.println(F("ERROR:INVALID_PARAMS"));
+        return false;
+      }
+      argv[argc++] = p + 1;
+    }
+  }
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (strcmp_P(argv[0], table[i].name) == 0)
+    {
+      CommandHandler handler = (CommandHandler)pgm_read_ptr(&table[i].handler);
+      handler(argc, argv);
+      return true;
+    }
+  }
+
+  serialOut.println(F("ERROR:UNKNOWN_COMMAND"));
+  return false;
+}
+
+bool parseUint8(const char *s, uint8_t &out)
+{
+  if (*s == '\0')
+    return false;
+
+  uint16_t value = 0;
+  for (; *s; s++)
+  {
+    if (*s < '0' || *s > '9')
+      return false;
+    value = value * 10 + (*s - '0');
+    if (value > 255)
+      return false;
+  }
+  out = (uint8_t)value;
+  return true;
+}
+
+bool parseUint16(const char *s, uint16_t &out)
+{
+  if (*s == '\0')
+    return false;
+
+  uint32_t value = 0;
+  for (; *s; s++)
+  {
+    if (*s < '0' || *s > '9')
+      return false;
+    value = value * 10 + (*s - '0');
+    if (value > 65535UL)
+      return false;
+  }
+  out = (uint16_t)value;
+  return true;
+}
+
+bool parseUint32(const char *s, uint32_t &out)
+{
+  if (*s == '\0')
+    return false;
+
+  uint32_t value = 0;
+  for (; *s; s++)
+  {
+    if (*s < '0' || *s > '9')
+      return false;
+    uint8_t digit = *s - '0';
+    if (value > (0xFFFFFFFFUL - digit) / 10)
+      return false;
+    value = value * 10 + digit;
+  }
+  out = value;
+  return true;
+}
@@ -0,0 +1,95 @@
+#include "config_store.h"
+#include "hal.h"
+#include "crc16.h"
+
+ConfigStore::ConfigStore(uint16_t base, uint8_t slotSize, uint8_t slotCount, uint8_t version)
+    : base(base), slotSize(slotSize), slotCount(slotCount), version(version),
+      current(-1), seq(0)
+{
+}
+
+// Header sane and CRC matches
+bool ConfigStore::slotValid(uint8_t slot, uint16_t &slotSeq, uint8_t &len) const
+{
+  uint16_t addr = slotAddr(slot);
+  if (halEepromRead(addr) != version)
+    return false;
+
+  len = halEepromRead(addr + 3);
+  if (len > slotSize - CONFIG_SLOT_OVERHEAD)
+    return false;
+
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < 4 + len; i++)
+    crc = crc16Update(crc, halEepromRead(addr + i));
+  uint16_t stored = halEepromRead(addr + 4 + len) | ((uint16_t)halEepromRead(addr + 5 + len) << 8);
+  if (crc != stored)
+    return false;
+
+  slotSeq = halEepromRead(addr + 1) | ((uint16_t)halEepromRead(addr + 2) << 8);
+  return true;
+}
+
+bool ConfigStore::load(void *data, uint8_t len)
+{
+  // One pass over a fixed number of slots - boot time is bounded
+  current = -1;
+  for (uint8_t slot = 0; slot < slotCount; slot++)
+  {
+    uint16_t slotSeq;
+    uint8_t slotLen;
+    if (!slotValid(slot, slotSeq, slotLen))
+      continue;
+    // Sequence numbers wrap, so compare the difference
+    if (current < 0 || (int16_t)(slotSeq - seq) > 0)
+    {
+      current = slot;
+      seq = slotSeq;
+    }
+  }
+
+  if (current < 0 || halEepromRead(slotAddr(current) + 3) != len)
+    return false;
+
+  uint8_t *out = (uint8_t *)data;
+  for (uint8_t i = 0; i < len; i++)
+    out[i] = halEepromRead(slotAddr(current) + 4 + i);
+  return true;
+}
+
+void ConfigStore::save(const void *data, uint8_t len)
+{
+  const uint8_t *in = (const uint8_t *)data;
+
+  // Same as the newest record? Then there is nothing to do.
+  if (current >= 0 && halEepromRead(slotAddr(current) + 3) == len)
+  {
+    uint8_t i = 0;
+    while (i < len && halEepromRead(slotAddr(current) + 4 + i) == in[i])
+      i++;
+    if (i == len)
+      return;
+  }
+
+  uint8_t slot = (current < 0) ? 0 : (current + 1) % slotCount;
+  uint16_t nextSeq = seq + 1;
+  uint16_t addr = slotAddr(slot);
+
+  uint8_t header[4] = {version, (uint8_t)(nextSeq & 0xFF), (uint8_t)(nextSeq >> 8), len};
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    crc = crc16Update(crc, header[i]);
+    halEepromUpdate(addr + i, header[i]);
+  }
+  for (uint8_t i = 0; i < len; i++)
+  {
+    crc = crc16Update(crc, in[i]);
+    halEepromUpdate(addr + 4 + i, in[i]);
+  }
+  halEepromUpdate(addr + 4 + len, crc & 0xFF);
+  halEepromUpdate(addr + 5 + len, crc >> 8);
+
+  current = slot;
+  seq = nextSeq;
+}
@@ -0,0 +1,209 @@
+#include "event_log.h"
+#include "hal.h"
+
+#define EVENT_LOG_MAGIC 0xE7
+#define DELTA_INLINE_MAX 30 // 31 in the type byte means "varint follows"
+
+// a is newer than b, allowing for wrap-around
+static inline bool seqAfter(uint16_t a, uint16_t b)
+{
+  return (int16_t)(a - b) > 0;
+}
+
+// Sequence numbers skip 0, which means "nothing yet"
+static inline uint16_t seqNext(uint16_t s)
+{
+  return s == 0xFFFF ? 1 : s + 1;
+}
+
+EventLog::EventLog(uint16_t base, uint8_t blockCount)
+    : base(base), blockCount(blockCount), current(-1), writePos(0),
+      nextSeq(1), lastMinute(0)
+{
+}
+
+bool EventLog::blockValid(uint8_t b, uint16_t &seq, uint32_t &minute) const
+{
+  uint16_t addr = blockAddr(b);
+  if (halEepromRead(addr) != EVENT_LOG_MAGIC)
+    return false;
+  seq = halEepromRead(addr + 1) | ((uint16_t)halEepromRead(addr + 2) << 8);
+  minute = 0;
+  for (uint8_t i = 0; i < 4; i++)
+    minute |= (uint32_t)halEepromRead(addr + 3 + i) << (8 * i);
+  return true;
+}
+
+bool EventLog::readRecord(uint8_t b, uint8_t &pos, uint8_t &type, uint32_t &delta, uint8_t &lag) const
+{
+  uint16_t addr = blockAddr(b);
+  if (pos >= EVENT_LOG_BLOCK_SIZE)
+    return false;
+  uint8_t first = halEepromRead(addr + pos);
+  if (first == 0xFF)
+    return false;
+
+  uint8_t p = pos + 1;
+  type = first & 0x07;
+  delta = first >> 3;
+  if (delta > DELTA_INLINE_MAX)
+  {
+    // LEB128: 7 bits per byte, high bit = more bytes follow
+    delta = 0;
+    uint8_t shift = 0;
+    uint8_t c;
+    do
+    {
+      if (p >= EVENT_LOG_BLOCK_SIZE || shift > 28)
+        return false;
+      c = halEepromRead(addr + p++);
+      delta |= (uint32_t)(c & 0x7F) << shift;
+      shift += 7;
+    } while (c & 0x80);
+  }
+  if (p >= EVENT_LOG_BLOCK_SIZE)
+    return false;
+  lag = halEepromRead(addr + p++);
+  pos = p;
+  return true;
+}
+
+void EventLog::begin()
+{
+  // Newest block = highest first seq
+  current = -1;
+  uint16_t newestSeq = 0;
+  for (uint8_t b = 0; b < blockCount; b++)
+  {
+    uint16_t seq;
+    uint32_t minute;
+    if (blockValid(b, seq, minute) && (current < 0 || seqAfter(seq, newestSeq)))
+    {
+      current = b;
+      newestSeq = seq;
+      lastMinute = minute;
+    }
+  }
+  if (current < 0)
+  {
+    nextSeq = 1;
+    return;
+  }
+
+  // Walk it to find the end
+  nextSeq = newestSeq;
+  writePos = EVENT_LOG_HEADER;
+  uint8_t type, lag;
+  uint32_t delta;
+  while (readRecord(current, writePos, type, delta, lag))
+  {
+    lastMinute += delta;
+    nextSeq = seqNext(nextSeq);
+  }
+  // A record torn by a power cut leaves its tail without the first byte.
+  // Clear it, or a shorter record written here later would run into it.
+  for (uint8_t i = writePos; i < EVENT_LOG_BLOCK_SIZE; i++)
+    halEepromUpdate(blockAddr(current) + i, 0xFF);
+}
+
+// Wipe the oldest block and make it the newest, starting at `minute`
+void EventLog::startBlock(uint32_t minute)
+{
+  current = (current + 1) % blockCount;
+  uint16_t addr = blockAddr(current);
+
+  halEepromUpdate(addr, 0xFF); // Invalid until the header is complete
+  for (uint8_t i = EVENT_LOG_HEADER; i < EVENT_LOG_BLOCK_SIZE; i++)
+    halEepromUpdate(addr + i, 0xFF);
+  halEepromUpdate(addr + 1, nextSeq & 0xFF);
+  halEepromUpdate(addr + 2, nextSeq >> 8);
+  for (uint8_t i = 0; i < 4; i++)
+    halEepromUpdate(addr + 3 + i, (minute >> (8 * i)) & 0xFF);
+  halEepromUpdate(addr, EVENT_LOG_MAGIC);
+
+  writePos = EVENT_LOG_HEADER;
+  lastMinute = minute;
+}
+
+void EventLog::append(uint8_t type, uint32_t minute, uint8_t lag)
+{
+  // The clock may have been set back - never store a negative delta
+  uint32_t delta = (current >= 0 && minute > lastMinute) ? minute - lastMinute : 0;
+
+  uint8_t rec[7];
+  uint8_t len = 0;
+  if (delta <= DELTA_INLINE_MAX)
+  {
+    rec[len++] = type | (delta << 3);
+  }
+  else
+  {
+    rec[len++] = type | ((DELTA_INLINE_MAX + 1) << 3);
+    uint32_t d = delta;
+    do
+    {
+      rec[len] = d & 0x7F;
+      d >>= 7;
+      if (d)
+        rec[len] |= 0x80;
+      len++;
+    } while (d);
+  }
+  rec[len++] = lag;
+
+  if (current < 0 || writePos + len > EVENT_LOG_BLOCK_SIZE)
+  {
+    startBlock(minute);
+    rec[0] = type; // Block header holds the time, delta 0
+    rec[1] = lag;
+    len = 2;
+  }
+
+  // Back to front: the first byte turns the record from 0xFF into valid
+  uint16_t addr = blockAddr(current) + writePos;
+  for (uint8_t i = len; i-- > 0;)
+    halEepromUpdate(addr + i, rec[i]);
+
+  writePos += len;
+  lastMinute = minute;
+  nextSeq = seqNext(nextSeq);
+}
+
+uint8_t EventLog::read(uint16_t since, LogEvent *out, uint8_t max, bool &more) const
+{
+  uint8_t count = 0;
+  more = false;
+  if (current < 0)
+    return 0;
+
+  // Oldest block first: the one after the newest, round the ring
+  for (uint8_t i = 1; i <= blockCount; i++)
+  {
+    uint8_t b = (current + i) % blockCount;
+    uint16_t seq;
+    uint32_t minute;
+    if (!blockValid(b, seq, minute))
+      continue;
+
+    uint8_t pos = EVENT_LOG_HEADER;
+    uint8_t type, lag;
+    uint32_t delta;
+    for (; readRecord(b, pos, type, delta, lag); seq = seqNext(seq))
+    {
+      minute += delta;
+      if (since != 0 && !seqAfter(seq, since))
+        continue;
+      if (count == max)
+      {
+        more = true;
+        return count;
+      }
+      out[count].seq = seq;
+      out[count].type = type;
+      out[count].lag = lag;
+      out[count].minute = minute;
+      count++;
+    }
+  }
+  return count;
+}
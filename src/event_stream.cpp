@@ -0,0 +1,76 @@
+#include "event_stream.h"
+
+// ---- Event names and value counts (in Flash) ----
+static const char namePower[] PROGMEM = "POWER";
+static const char nameAlarm[] PROGMEM = "ALARM";
+static const char nameTaken[] PROGMEM = "TAKEN";
+static const char nameLate[] PROGMEM = "LATE";
+static const char nameMissed[] PROGMEM = "MISSED";
+static const char nameCancelled[] PROGMEM = "CANCELLED";
+static const char nameAlarmSet[] PROGMEM = "ALARM_SET";
+static const char nameAlarmEnabled[] PROGMEM = "ALARM_ENABLED";
+static const char nameAlarmDays[] PROGMEM = "ALARM_DAYS";
+static const char nameAlarmDeleted[] PROGMEM = "ALARM_DELETED";
+static const char nameSchedule[] PROGMEM = "SCHEDULE";
+
+struct PushEventInfo
+{
+  const char *name;
+  uint8_t values;
+};
+
+static const PushEventInfo eventInfo[PUSH_TYPE_COUNT] PROGMEM = {
+    {namePower, 1},
+    {nameAlarm, 2},
+    {nameTaken, 2},
+    {nameLate, 2},
+    {nameMissed, 2},
+    {nameCancelled, 2},
+    {nameAlarmSet, 3},
+    {nameAlarmEnabled, 2},
+    {nameAlarmDays, 2},
+    {nameAlarmDeleted, 2},
+    {nameSchedule, 1},
+};
+
+EventStream::EventStream(BinaryLink &link, SerialOut &out)
+    : link(link), out(out), seq(0), enabled(false)
+{
+}
+
+void EventStream::push(uint8_t type, uint8_t a, uint8_t b, uint8_t c)
+{
+  if (++seq == 0)
+    seq = 1; // 0 means "none yet"
+  if (!enabled || type >= PUSH_TYPE_COUNT)
+    return;
+
+  uint8_t values[3] = {a, b, c};
+  uint8_t n = pgm_read_byte(&eventInfo[type].values);
+
+  out.begin();
+  if (link.active())
+  {
+    uint8_t payload[6];
+    payload[0] = seq & 0xFF;
+    payload[1] = seq >> 8;
+    payload[2] = type;
+    for (uint8_t i = 0; i < n; i++)
+      payload[3 + i] = values[i];
+    link.sendEvent(out, payload, 3 + n);
+    out.end();
+    return;
+  }
+
+  out.print(F("EVT:"));
+  out.print(seq);
+  out.print(':');
+  out.print((const __FlashStringHelper *)pgm_read_ptr(&eventInfo[type].name));
+  for (uint8_t i = 0; i < n; i++)
+  {
+    out.print(':');
+    out.print(values[i]);
+  }
+  out.println();
+  out.end();
+}
@@ -0,0 +1,269 @@
+#include "hal.h"
+#include "perf.h"
+#include "twi.h"
+#include <EEPROM.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+
+// Real-board side of hal.h - thin wrappers over the Arduino core, plus
+// the DS1307 registers over the TWI driver (twi.h)
+
+// ---- Time ----
+unsigned long halMillis()
+{
+  return millis();
+}
+
+unsigned long halMicros()
+{
+  return micros();
+}
+
+void halDelay(unsigned long ms)
+{
+  delay(ms);
+}
+
+// ---- GPIO ----
+void halPinMode(uint8_t pin, uint8_t mode)
+{
+  pinMode(pin, mode);
+}
+
+void halDigitalWrite(uint8_t pin, uint8_t level)
+{
+  digitalWrite(pin, level);
+}
+
+uint8_t halDigitalRead(uint8_t pin)
+{
+  return digitalRead(pin);
+}
+
+// ---- Reset cause + watchdog ----
+// After a watchdog reset WDRF stays set and keeps the watchdog running at
+// its shortest timeout, which would reset us again in the middle of
+// setup(). So the flags are saved and cleared in .init3, before the C
+// runtime even clears .bss - hence .noinit for the copy. Optiboot clears
+// MCUSR itself and hands its value over in r2.
+static uint8_t resetFlags __attribute__((section(".noinit")));
+static bool watchdogOn = false;
+
+void halSaveResetFlags() __attribute__((naked, used, section(".init3")));
+void halSaveResetFlags()
+{
+  uint8_t flags = MCUSR;
+  if (!flags)
+    __asm__ __volatile__("mov %0, r2" : "=r"(flags));
+  resetFlags = flags;
+  MCUSR = 0;
+  wdt_disable();
+}
+
+uint8_t halResetFlags()
+{
+  return resetFlags;
+}
+
+void halWatchdogBegin()
+{
+  wdt_enable(WDTO_4S); // HAL_WATCHDOG_MS
+  watchdogOn = true;
+}
+
+void halWatchdogKick()
+{
+  wdt_reset();
+}
+
+// ---- Sleep ----
+// RX (D0) is PD0 = PCINT16. Only armed while in power-down - a start bit
+// is enough to wake us, but during normal operation the UART handles RX.
+static volatile bool rxWoke = false;
+
+ISR(PCINT2_vect) // D0-D7
+{
+  rxWoke = true;
+  PCMSK2 &= ~bit(PCINT16);
+}
+
+void halSleepIdle(unsigned long untilMs)
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  sleep_cpu();
+  sleep_disable();
+}
+
+bool halSleepPowerDown()
+{
+  rxWoke = false;
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+
+  while (twiBusy())
+    ; // The TWI clock stops too - let the last OLED page go out first
+  if (watchdogOn)
+    wdt_disable(); // Could sleep for hours - a watchdog reset would wake us
+  cli();
+  PCICR |= bit(PCIE2);
+  PCIFR = bit(PCIF2); // Forget edges from bytes already received
+  PCMSK2 |= bit(PCINT16);
+  sleep_enable();
+  sei();       // The instruction after sei always runs first, so an
+  sleep_cpu(); // interrupt can't sneak in between and be missed
+  sleep_disable();
+
+  PCMSK2 &= ~bit(PCINT16);
+  if (watchdogOn)
+    wdt_enable(WDTO_4S);
+  return rxWoke;
+}
+
+// ---- I2C bus + RTC ----
+#define DS1307_ADDR 0x68
+#define DS1307_CH 0x80        // Seconds register: clock halted
+#define DS1307_SQW_1HZ 0x10   // Control register: SQWE, RS = 1 Hz
+
+static TwiTxn rtcTxn;
+
+void halI2cBegin()
+{
+  twiBegin();
+}
+
+bool halI2cProbe(uint8_t addr)
+{
+  TwiTxn probe = {}; // Address only, no bytes
+  probe.addr = addr;
+  twiSubmit(probe);
+  return twiWait(probe) == TWI_DONE;
+}
+
+// Read n registers from reg on. Urgent, so it slots in between the OLED
+// pages of a flush() that is still going out.
+static bool rtcRead(uint8_t reg, uint8_t *buf, uint8_t n)
+{
+  rtcTxn.addr = DS1307_ADDR;
+  rtcTxn.head[0] = reg;
+  rtcTxn.headLen = 1;
+  rtcTxn.dataLen = 0;
+  rtcTxn.readBuf = buf;
+  rtcTxn.readLen = n;
+  twiSubmit(rtcTxn, true);
+  return twiWait(rtcTxn) == TWI_DONE;
+}
+
+// Write n (< TWI_HEAD_MAX) registers from reg on
+static bool rtcWrite(uint8_t reg, const uint8_t *buf, uint8_t n)
+{
+  rtcTxn.addr = DS1307_ADDR;
+  rtcTxn.head[0] = reg;
+  memcpy(rtcTxn.head + 1, buf, n);
+  rtcTxn.headLen = n + 1;
+  rtcTxn.dataLen = 0;
+  rtcTxn.readLen = 0;
+  twiSubmit(rtcTxn, true);
+  return twiWait(rtcTxn) == TWI_DONE;
+}
+
+static uint8_t bcd2bin(uint8_t v)
+{
+  return v - 6 * (v >> 4);
+}
+
+static uint8_t bin2bcd(uint8_t v)
+{
+  return v + 6 * (v / 10);
+}
+
+// Days from 2000-01-01 to 20yy-mm-dd (what RTClib's DateTime does)
+static uint16_t date2days(uint8_t y, uint8_t m, uint8_t d)
+{
+  static const uint8_t daysInMonth[] PROGMEM = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
+  uint16_t days = d;
+  for (uint8_t i = 1; i < m; i++)
+    days += pgm_read_byte(daysInMonth + i - 1);
+  if (m > 2 && y % 4 == 0)
+    days++;
+  return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+// "Jan  6 2025" -> digits, the day may start with a space
+static uint8_t conv2d(const char *p)
+{
+  uint8_t v = (p[0] >= '0' && p[0] <= '9') ? p[0] - '0' : 0;
+  return 10 * v + p[1] - '0';
+}
+
+// Set the clock to when this firmware was compiled
+static void rtcSetBuildTime()
+{
+  static const char date[] = __DATE__; // "Mmm dd yyyy"
+  static const char time[] = __TIME__; // "hh:mm:ss"
+  uint8_t m;
+  switch (date[0])
+  {
+  case 'J': m = (date[1] == 'a') ? 1 : ((date[2] == 'n') ? 6 : 7); break;
+  case 'F': m = 2; break;
+  case 'A': m = (date[2] == 'r') ? 4 : 8; break;
+  case 'M': m = (date[2] == 'r') ? 3 : 5; break;
+  case 'S': m = 9; break;
+  case 'O': m = 10; break;
+  case 'N': m = 11; break;
+  default: m = 12; break;
+  }
+  uint8_t d = conv2d(date + 4);
+  uint8_t y = conv2d(date + 9);
+  uint8_t dow = (date2days(y, m, d) + 6) % 7; // 0 = Sunday
+
+  uint8_t regs[7] = {
+      bin2bcd(conv2d(time + 6)), // Seconds, CH = 0 starts the oscillator
+      bin2bcd(conv2d(time + 3)),
+      bin2bcd(conv2d(time)),     // 24-hour mode
+      (uint8_t)(dow ? dow : 7),  // 1 = Monday ... 7 = Sunday, like RTClib
+      bin2bcd(d),
+      bin2bcd(m),
+      bin2bcd(y)};
+  rtcWrite(0, regs, sizeof(regs));
+}
+
+bool halRtcBegin()
+{
+  uint8_t sec;
+  if (!rtcRead(0, &sec, 1))
+    return false;
+  if (sec & DS1307_CH) // Never set, or the backup battery ran out
+    rtcSetBuildTime();
+  return true;
+}
+
+bool halRtcRead(uint32_t &t)
+{
+  PERF_SCOPE(PERF_I2C);
+  uint8_t r[7];
+  if (!rtcRead(0, r, sizeof(r)))
+    return false;
+  uint8_t ss = bcd2bin(r[0] & 0x7F);
+  uint8_t mm = bcd2bin(r[1]);
+  uint8_t hh = bcd2bin(r[2] & 0x3F);
+  uint16_t days = date2days(bcd2bin(r[6]), bcd2bin(r[5]), bcd2bin(r[4]));
+  t = ((days * 24UL + hh) * 60 + mm) * 60 + ss;
+  return true;
+}
+
+void halRtcSquareWave()
+{
+  uint8_t control = DS1307_SQW_1HZ;
+  rtcWrite(7, &control, 1);
+}
+
+// ---- EEPROM ----
+uint8_t halEepromRead(uint16_t addr)
+{
+  return EEPROM.read(addr);
+}
+
+void halEepromUpdate(uint16_t addr, uint8_t value)
+{
+  EEPROM.update(addr, value);
+}
@@ -0,0 +1,149 @@
+#include "leds.h"
+#include "hal.h"
+
+// ---- Wanted state (set by loop(), blink phase by the ISR) ----
+static volatile uint8_t steadyMask = 0;
+static volatile uint8_t blinkMask = 0;
+static volatile bool blinkOn = true;
+static volatile uint8_t litMask = 0; // What is on the pins
+
+#ifdef __AVR__
+// Timer0 overflows every 64 * 256 clocks = 1.024 ms at 16 MHz
+#define BLINK_TICKS ((uint16_t)(LED_BLINK_MS * (F_CPU / 1000UL) / (64UL * 256UL)))
+
+// The LED pins grouped by port register (PORTD and PORTB here). The Uno
+// has three ports, so any pin table fits.
+#define LED_PORTS 3
+static volatile uint8_t *portReg[LED_PORTS];
+static uint8_t portMask[LED_PORTS]; // All LED bits on that port
+static uint8_t portCount = 0;
+static uint8_t ledPort[LED_COUNT];  // Index into portReg[]
+static uint8_t ledBit[LED_COUNT];
+
+static volatile uint16_t blinkTicks = 0;
+#else
+static uint8_t ledPin[LED_COUNT];
+static unsigned long blinkStart = 0; // millis() the blinking mask was set
+#endif
+
+// Put `mask` on the pins if it isn't there already. Interrupts are off.
+static void apply(uint8_t mask)
+{
+  uint8_t changed = mask ^ litMask;
+  if (!changed)
+    return;
+  litMask = mask;
+
+#ifdef __AVR__
+  for (uint8_t p = 0; p < portCount; p++)
+  {
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < LED_COUNT; i++)
+      if (ledPort[i] == p && (mask & (1 << i)))
+        bits |= ledBit[i];
+    volatile uint8_t *reg = portReg[p];
+    *reg = (*reg & ~portMask[p]) | bits;
+  }
+#else
+  for (uint8_t i = 0; i < LED_COUNT; i++)
+    if (changed & (1 << i))
+      halDigitalWrite(ledPin[i], (mask & (1 << i)) ? HIGH : LOW);
+#endif
+}
+
+static inline uint8_t wanted()
+{
+  return steadyMask | (blinkOn ? blinkMask : 0);
+}
+
+#ifdef __AVR__
+ISR(TIMER0_COMPB_vect)
+{
+  if (++blinkTicks < BLINK_TICKS)
+    return;
+  blinkTicks = 0;
+  blinkOn = !blinkOn;
+  apply(wanted());
+}
+#endif
+
+// Host builds: the phase the ISR would be in by now
+static void catchUp()
+{
+#ifndef __AVR__
+  if (!blinkMask)
+    return;
+  blinkOn = !(((halMillis() - blinkStart) / LED_BLINK_MS) & 1);
+  apply(wanted());
+#endif
+}
+
+void ledsBegin(const uint8_t *pins)
+{
+  for (uint8_t i = 0; i < LED_COUNT; i++)
+  {
+    halPinMode(pins[i], OUTPUT);
+#ifdef __AVR__
+    volatile uint8_t *reg = portOutputRegister(digitalPinToPort(pins[i]));
+    uint8_t p = 0;
+    while (p < portCount && portReg[p] != reg)
+      p++;
+    if (p == portCount)
+    {
+      portReg[portCount] = reg;
+      portMask[portCount] = 0;
+      portCount++;
+    }
+    ledPort[i] = p;
+    ledBit[i] = digitalPinToBitMask(pins[i]);
+    portMask[p] |= ledBit[i];
+#else
+    ledPin[i] = pins[i];
+#endif
+  }
+
+  litMask = LED_ALL; // Force the first write
+  ledsShow(0, 0);
+}
+
+void ledsShow(uint8_t steady, uint8_t blinking)
+{
+  steady &= LED_ALL;
+  blinking &= LED_ALL & ~steady;
+
+#ifdef __AVR__
+  uint8_t oldSREG = SREG;
+  cli();
+#endif
+  if (blinking != blinkMask)
+  {
+    blinkMask = blinking;
+    blinkOn = true;
+#ifdef __AVR__
+    blinkTicks = 0;
+    if (blinking)
+    {
+      TIFR0 = bit(OCF0B); // Count from the next tick
+      TIMSK0 |= bit(OCIE0B);
+    }
+    else
+    {
+      TIMSK0 &= ~bit(OCIE0B);
+    }
+#else
+    blinkStart = halMillis();
+#endif
+  }
+  steadyMask = steady;
+  catchUp();
+  apply(wanted());
+#ifdef __AVR__
+  SREG = oldSREG;
+#endif
+}
+
+uint8_t ledsLit()
+{
+  catchUp();
+  return litMask; // Single byte - atomic to read
+}
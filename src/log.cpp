@@ -0,0 +1,90 @@
+#include "log.h"
+#include "hal.h"
+#include "serial_out.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+#if LOG_LEVEL > LOG_LEVEL_NONE
+
+#define LOG_LINE_MAX 64
+
+// Minimum time between two lines of the same class (ms)
+static const uint16_t logInterval[LOG_CLASS_COUNT] PROGMEM = {
+    0,     // LOG_SYSTEM - rare, never limited
+    0,     // LOG_ALARM  - rare, never limited
+    250,   // LOG_BUTTON
+    10000, // LOG_LED    - same line every loop pass otherwise
+    0,     // LOG_MENU
+    500,   // LOG_BUZZER
+};
+
+static unsigned long lastLine[LOG_CLASS_COUNT];
+static uint8_t skipped[LOG_CLASS_COUNT];
+
+uint16_t logDroppedBusy = 0;
+uint16_t logDroppedRate = 0;
+
+void logWrite(uint8_t cls, const char *fmt, ...)
+{
+  unsigned long now = halMillis();
+  uint16_t interval = pgm_read_word(&logInterval[cls]);
+  if (interval && lastLine[cls] && now - lastLine[cls] < interval)
+  {
+    if (skipped[cls] < 255)
+      skipped[cls]++;
+    logDroppedRate++;
+    return;
+  }
+
+  // "# " + message + " (+N)" + "\r\n", cut to fit. The text (and the
+  // '\0' snprintf adds) ends before the last 2 bytes kept for "\r\n".
+  char line[LOG_LINE_MAX];
+  const uint8_t textEnd = sizeof(line) - 2;
+  line[0] = '#';
+  line[1] = ' ';
+  uint8_t len = 2;
+
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf_P(line + len, textEnd - len, fmt, args);
+  va_end(args);
+  if (n < 0)
+    return;
+  len += (n < textEnd - len - 1) ? n : textEnd - len - 1;
+
+  if (skipped[cls])
+  {
+    n = snprintf_P(line + len, textEnd - len, PSTR(" (+%u)"), skipped[cls]);
+    if (n > 0)
+      len += (n < textEnd - len - 1) ? n : textEnd - len - 1;
+  }
+  line[len++] = '\r';
+  line[len++] = '\n';
+
+  // Never wait for the UART - drop the line if it doesn't fit right now,
+  // and mention it on the next one
+#ifdef LOG_PORT
+  bool queued = LOG_PORT.availableForWrite() >= len;
+  if (queued)
+    LOG_PORT.write((const uint8_t *)line, len);
+#else
+  bool queued = serialOut.writeDiag((const uint8_t *)line, len);
+#endif
+  if (!queued)
+  {
+    if (skipped[cls] < 255)
+      skipped[cls]++;
+    logDroppedBusy++;
+    return;
+  }
+
+  lastLine[cls] = now ? now : 1;
+  skipped[cls] = 0;
+}
+
+#else
+
+uint16_t logDroppedBusy = 0;
+uint16_t logDroppedRate = 0;
+
+#endif
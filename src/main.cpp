@@ -1,8 +1,21 @@
 #include <Arduino.h>
-#include <Adafruit_SSD1306.h>
-#include <Wire.h>
-#include <RTClib.h>
-#include <EEPROM.h>
+#include "hal.h"
+#include "command_reader.h"
+#include "binary_link.h"
+#include "buttons.h"
+#include "log.h"
+#include "config_store.h"
+#include "alarm_schedule.h"
+#include "power.h"
+#include "soft_clock.h"
+#include "event_log.h"
+#include "event_stream.h"
+#include "serial_speed.h"
+#include "serial_out.h"
+#include "perf.h"
+#include "buzzer.h"
+#include "leds.h"
+#include "boot.h"
 
 // Guide:
 // Power: BLACK button (Pin A1) - Toggle system ON/OFF (starts OFF by default)
@@ -17,10 +30,10 @@
 // OLED Display
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
+// Only changed regions are sent over I2C - see oled.h
+Display display(SCREEN_WIDTH, SCREEN_HEIGHT);
 
-// RTC Module
-RTC_DS1307 rtc;
+// RTC Module: read through hal.h (halRtcRead)
 
 // Pin definitions
 const uint8_t upbtn = 10;
@@ -29,23 +42,25 @@ const uint8_t setbtn = 12;
 const uint8_t confirmbtn = 13;
 const uint8_t homebtn = A0;       // BLACK button - Home/Cancel
 const uint8_t powerswitch = A1;  // SLIDE SWITCH - Power ON/OFF toggle
+const uint8_t rtcSqw = A2;       // DS1307 SQW/OUT - 1 Hz tick, wakes us from sleep
 const uint8_t buzzer = 9;
 const uint8_t ledPins[] = {2, 3, 4, 5, 6, 7, 8};
 
-// Alarm structure (compact to save RAM)
-struct Alarm
-{
-  uint8_t hour;   // 0-23
-  uint8_t minute; // 0-59
-  bool enabled;
-};
+// I2C addresses
+const uint8_t oledAddr = 0x3C;   // SSD1306
+const uint8_t rtcAddr = 0x68;    // DS1307
 
-// 3 alarms: Morning, Afternoon, Evening
-Alarm alarms[3] = {
-    {8, 0, true},  // Morning 8:00 AM
-    {13, 0, true}, // Afternoon 1:00 PM
-    {20, 0, true}  // Evening 8:00 PM
+// Up to MAX_ALARMS alarms, each with its own days (see alarm_schedule.h)
+// Default: Morning, Afternoon, Evening every day
+Alarm alarms[MAX_ALARMS] = {
+    {8, 0, ALL_DAYS, true},  // Morning 8:00 AM
+    {13, 0, ALL_DAYS, true}, // Afternoon 1:00 PM
+    {20, 0, ALL_DAYS, true}  // Evening 8:00 PM
 };
+uint8_t alarmCount = 3;
+
+// When the next alarm is due
+AlarmIndex alarmIndex;
 
 // Menu state
 enum MenuState
@@ -59,165 +74,1126 @@ MenuState menu = NORMAL;
 uint8_t selectedDose = 0;
 uint8_t tempHour = 0;
 uint8_t tempMinute = 0;
+uint16_t editVersion = 0; // configVersion() when the edit started
 
 // Power state
 bool systemPowered = false;  // System starts OFF by default
 bool lastSwitchState = HIGH; // Track switch state for toggle detection
 
-// Debouncing
-unsigned long lastBtn = 0;
+// Buzzer test (CONFIRM on the clock screen) - LEDs follow the beeps
+bool buzzerTestRunning = false;
+
+// Low-power sleep (see power.h)
+unsigned long lastSerialActivity = 0; // millis() of the last byte received
+uint8_t lastRtcTick = 0;              // rtcTickCount() at the start of this pass
+uint16_t powerWindowTicks = 0;        // RTC seconds since the last GET_POWER
+
+// ==================== CLOCK ====================
+// Everything reads the time from softClock (see soft_clock.h). The DS1307
+// is only read to resync it.
+SoftClock softClock;
+
+// A reading taken this soon after an RTC tick belongs to that tick's second
+#define CLOCK_TICK_WINDOW_MS 900
+
+// Resync from the RTC. If it doesn't answer, the clock carries on from
+// the last good reading - a made-up time would look like the clock being
+// set back, and doses already handled could ring again.
+void syncClock()
+{
+  uint8_t tick = rtcTickCount();
+  unsigned long readMs = halMillis();
+  uint32_t t;
+  bool ok = halRtcRead(t);
+  if (ok && rtcTickCount() != tick)
+  {
+    // The second rolled over during the read - which one did we get?
+    readMs = halMillis();
+    ok = halRtcRead(t);
+  }
+  if (!ok)
+  {
+    softClock.syncFailed();
+    LOG_WARN(LOG_SYSTEM, "RTC not answering, clock not synced");
+    return;
+  }
+
+  // rtcTickTime() is 0 until the first tick (no SQW wire)
+  unsigned long tickMs = rtcTickTime();
+  bool aligned = (tickMs != 0 && readMs - tickMs < CLOCK_TICK_WINDOW_MS);
+  if (aligned)
+    softClock.sync(t, tickMs, true);
+  else
+    softClock.sync(t, readMs - 500, false); // Middle of the second
+
+  LOG_DEBUG(LOG_SYSTEM, "Clock sync: error %ld ms, drift %ld ppm",
+            (long)softClock.lastErrorMs, (long)softClock.driftPpm);
+}
+
+// Seconds since 2000-01-01, resyncing first when due
+uint32_t clockSeconds()
+{
+  if (softClock.needsSync())
+    syncClock();
+  return softClock.now();
+}
+
+ClockTime clockNow()
+{
+  return ClockTime(clockSeconds());
+}
+
+// ==================== EEPROM FUNCTIONS ====================
+// EEPROM map (1024 bytes on the Uno):
+//   0 - 511     Alarm settings, 8 slots x 64 bytes (see config_store.h)
+//   512 - 959   Adherence event log, 7 blocks x 64 bytes (see event_log.h)
+//   960 - 991   Device settings, 2 slots x 16 bytes
+//   992 - 1023  Active reminder checkpoint, 2 slots x 16 bytes
+#define EEPROM_ALARMS_BASE 0
+#define EEPROM_ALARMS_SLOT_SIZE 64
+#define EEPROM_ALARMS_SLOTS 8
+#define ALARMS_RECORD_VERSION 1 // Payload: count, then Alarm x MAX_ALARMS
+#define EEPROM_EVENTS_BASE 512
+#define EEPROM_EVENTS_BLOCKS 7
+#define EEPROM_SETTINGS_BASE 960
+#define EEPROM_SETTINGS_SLOT_SIZE 16
+#define EEPROM_SETTINGS_SLOTS 2
+#define SETTINGS_RECORD_VERSION 1 // Payload: Settings
+#define EEPROM_CHECKPOINT_BASE 992
+#define EEPROM_CHECKPOINT_SLOT_SIZE 16
+#define EEPROM_CHECKPOINT_SLOTS 2
+#define CHECKPOINT_RECORD_VERSION 1 // Payload: ReminderCheckpoint
+
+EventLog eventLog(EEPROM_EVENTS_BASE, EEPROM_EVENTS_BLOCKS);
+
+ConfigStore alarmStore(EEPROM_ALARMS_BASE, EEPROM_ALARMS_SLOT_SIZE, EEPROM_ALARMS_SLOTS,
+                       ALARMS_RECORD_VERSION);
+
+// Everything else that should survive a reset
+struct Settings
+{
+  uint32_t baud; // Last serial rate a host confirmed (see serial_speed.h)
+};
+
+Settings settings = {BAUD_DEFAULT};
+
+ConfigStore settingsStore(EEPROM_SETTINGS_BASE, EEPROM_SETTINGS_SLOT_SIZE, EEPROM_SETTINGS_SLOTS,
+                          SETTINGS_RECORD_VERSION);
+
+void loadSettings()
+{
+  Settings stored;
+  if (settingsStore.load(&stored, sizeof(stored)))
+    settings = stored;
+}
+
+void saveSettings()
+{
+  settingsStore.save(&settings, sizeof(settings));
+}
+
+// The reminder that is ringing, so a reset in the middle of its 15 minutes
+// doesn't lose it (see boot.h). Written when it starts, when it goes to
+// snooze and when it ends - about three small writes per dose.
+struct ReminderCheckpoint
+{
+  uint32_t start; // clockSeconds() when the alarm fired, 0 = no reminder
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t dayIdx;
+  uint8_t phase;  // ReminderPhase
+};
+
+ConfigStore checkpointStore(EEPROM_CHECKPOINT_BASE, EEPROM_CHECKPOINT_SLOT_SIZE,
+                            EEPROM_CHECKPOINT_SLOTS, CHECKPOINT_RECORD_VERSION);
+
+void saveAlarms()
+{
+  uint8_t record[1 + sizeof(alarms)];
+  record[0] = alarmCount;
+  memcpy(record + 1, alarms, sizeof(alarms));
+  alarmStore.save(record, sizeof(record));
+}
+
+// Firmware before the wear-leveled store kept hour/minute/enabled of
+// the 3 alarms raw at addresses 0-8
+bool loadLegacyAlarms()
+{
+  Alarm legacy[3];
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    legacy[i].hour = halEepromRead(i * 3);
+    legacy[i].minute = halEepromRead(i * 3 + 1);
+    uint8_t enabled = halEepromRead(i * 3 + 2);
+    if (legacy[i].hour > 23 || legacy[i].minute > 59 || enabled > 1)
+      return false;
+    legacy[i].days = ALL_DAYS;
+    legacy[i].enabled = enabled;
+  }
+  memcpy(alarms, legacy, sizeof(legacy));
+  alarmCount = 3;
+  return true;
+}
+
+void loadAlarms()
+{
+  uint8_t record[1 + sizeof(alarms)];
+  if (alarmStore.load(record, sizeof(record)) && record[0] <= MAX_ALARMS)
+  {
+    alarmCount = record[0];
+    memcpy(alarms, record + 1, sizeof(alarms));
+    return;
+  }
+
+  // Nothing valid in the store: keep old settings if there are any,
+  // otherwise the defaults, and write them as the first record
+  if (loadLegacyAlarms())
+    LOG_INFO(LOG_SYSTEM, "Alarms migrated from old EEPROM layout");
+  saveAlarms();
+}
+
+// ==================== SERIAL COMMUNICATION ====================
+// LEARNING NOTE: Serial communication allows Arduino to talk to computer/website
+// Commands format: "COMMAND:param1:param2:param3"
+// This lets us control Arduino from the dashboard!
+// Each command is a small function; the table below maps names to them.
+
+// Shared by the text and binary protocols (parameters already validated)
+
+// Pushed change events (see event_stream.h) - defined with binaryLink below
+extern EventStream events;
+
+// Current baud rate and SET_BAUD probation (see serial_speed.h)
+SerialSpeed serialSpeed;
+
+// Work out the next due alarm again - after every change to alarms[]
+void rescheduleAlarms()
+{
+  alarmIndex.rebuild(alarms, alarmCount, clockSeconds() / 60);
+}
+
+void alarmsChanged()
+{
+  saveAlarms(); // Save to EEPROM immediately!
+  rescheduleAlarms();
+}
+
+// index == alarmCount adds a new alarm (every day, enabled)
+bool validAlarmIndex(uint8_t index, bool allowNew)
+{
+  return index < alarmCount || (allowNew && index == alarmCount && index < MAX_ALARMS);
+}
+
+void setAlarm(uint8_t index, uint8_t hour, uint8_t minute)
+{
+  if (index == alarmCount)
+  {
+    alarms[index].days = ALL_DAYS;
+    alarms[index].enabled = true;
+    alarmCount++;
+  }
+  alarms[index].hour = hour;
+  alarms[index].minute = minute;
+  alarmsChanged();
+  events.push(PUSH_ALARM_SET, index, hour, minute);
+}
+
+void toggleAlarm(uint8_t index)
+{
+  alarms[index].enabled = !alarms[index].enabled;
+  alarmsChanged();
+  events.push(PUSH_ALARM_ENABLED, index, alarms[index].enabled);
+}
+
+void setAlarmDays(uint8_t index, uint8_t days)
+{
+  alarms[index].days = days;
+  alarmsChanged();
+  events.push(PUSH_ALARM_DAYS, index, days);
+}
+
+void deleteAlarm(uint8_t index)
+{
+  alarmCount--;
+  for (uint8_t i = index; i < alarmCount; i++)
+    alarms[i] = alarms[i + 1];
+  alarmsChanged();
+  events.push(PUSH_ALARM_DELETED, index, alarmCount);
+}
+
+// Changes with every schedule change that reaches EEPROM. A host that
+// kept the version from GET_SNAPSHOT can tell its copy is still current.
+uint16_t configVersion()
+{
+  return alarmStore.sequence();
+}
+
+// Replace the whole schedule: one EEPROM write, one index rebuild, one event
+void setSchedule(const Alarm *list, uint8_t count)
+{
+  memcpy(alarms, list, count * sizeof(Alarm));
+  alarmCount = count;
+  alarmsChanged();
+  events.push(PUSH_SCHEDULE, count);
+}
+
+bool validAlarm(uint8_t hour, uint8_t minute, uint8_t enabled, uint8_t days)
+{
+  return hour < 24 && minute < 60 && enabled <= 1 && days <= ALL_DAYS;
+}
+
+// ---- Batch upload (text protocol) ----
+// BATCH_BEGIN stages a copy of the schedule, BATCH_SET lines change it,
+// BATCH_COMMIT checks it and hands it to setSchedule(). Nothing touches
+// the real schedule before that, so it's all or nothing: after a rejected
+// line the commit is refused too. So is a commit after the schedule was
+// changed some other way - the copy staged at BATCH_BEGIN is stale then.
+struct ScheduleBatch
+{
+  Alarm alarms[MAX_ALARMS];
+  uint8_t count;
+  uint16_t version; // configVersion() at BATCH_BEGIN
+  uint16_t staged; // Bit i: alarm i was set in this batch
+  bool open;
+  bool failed;
+};
+
+ScheduleBatch batch;
+
+void batchBegin(uint8_t count)
+{
+  memcpy(batch.alarms, alarms, sizeof(alarms));
+  batch.count = count;
+  batch.version = configVersion();
+  batch.staged = 0;
+  batch.open = true;
+  batch.failed = false;
+}
+
+bool batchSet(uint8_t index, uint8_t hour, uint8_t minute, uint8_t enabled, uint8_t days)
+{
+  if (!batch.open || index >= batch.count || !validAlarm(hour, minute, enabled, days))
+  {
+    batch.failed = true;
+    return false;
+  }
+  batch.alarms[index].hour = hour;
+  batch.alarms[index].minute = minute;
+  batch.alarms[index].enabled = enabled;
+  batch.alarms[index].days = days;
+  batch.staged |= 1U << index;
+  return true;
+}
+
+// The schedule hasn't changed since BATCH_BEGIN
+bool batchCurrent()
+{
+  return configVersion() == batch.version;
+}
+
+// Alarms past the old count have no old value to keep - all must be set.
+// (alarmCount is still the count from BATCH_BEGIN if the batch is current.)
+bool batchCommit()
+{
+  bool ok = batch.open && !batch.failed && batchCurrent();
+  for (uint8_t i = alarmCount; ok && i < batch.count; i++)
+    ok = batch.staged & (1U << i);
+  batch.open = false;
+  if (ok)
+    setSchedule(batch.alarms, batch.count);
+  return ok;
+}
+
+// GET_ALARMS - Send all alarm data to website
+void cmdGetAlarms(uint8_t argc, char **argv)
+{
+  // Format: ALARMS:hour1:min1:enabled1:hour2:min2:enabled2:... (one triple per alarm)
+  serialOut.print(F("ALARMS:"));
+  for (uint8_t i = 0; i < alarmCount; i++)
+  {
+    if (i > 0)
+      serialOut.print(':');
+    serialOut.print(alarms[i].hour);
+    serialOut.print(':');
+    serialOut.print(alarms[i].minute);
+    serialOut.print(':');
+    serialOut.print(alarms[i].enabled ? 1 : 0);
+  }
+  serialOut.println();
+}
+
+// GET_SCHEDULE - Like GET_ALARMS plus the days of each alarm
+void cmdGetSchedule(uint8_t argc, char **argv)
+{
+  // Format: SCHEDULE:hour:min:enabled:days:... (days: bit 0 = Sunday)
+  serialOut.print(F("SCHEDULE:"));
+  for (uint8_t i = 0; i < alarmCount; i++)
+  {
+    if (i > 0)
+      serialOut.print(':');
+    serialOut.print(alarms[i].hour);
+    serialOut.print(':');
+    serialOut.print(alarms[i].minute);
+    serialOut.print(':');
+    serialOut.print(alarms[i].enabled ? 1 : 0);
+    serialOut.print(':');
+    serialOut.print(alarms[i].days);
+  }
+  serialOut.println();
+}
+
+// SET_ALARM:index:hour:minute - Update specific alarm
+// Example: "SET_ALARM:0:9:30" sets Morning alarm to 9:30 AM
+// Using index = number of alarms adds a new one
+void cmdSetAlarm(uint8_t argc, char **argv)
+{
+  uint8_t index, hour, minute;
+
+  // Validate input
+  if (argc == 4 &&
+      parseUint8(argv[1], index) && parseUint8(argv[2], hour) && parseUint8(argv[3], minute) &&
+      validAlarmIndex(index, true) && hour < 24 && minute < 60)
+  {
+    setAlarm(index, hour, minute);
+
+    serialOut.print(F("OK:"));
+    serialOut.print(index);
+    serialOut.print(':');
+    serialOut.print(hour);
+    serialOut.print(':');
+    serialOut.println(minute);
+  }
+  else
+  {
+    serialOut.println(F("ERROR:INVALID_PARAMS"));
+  }
+}
+
+// TOGGLE_ALARM:index - Enable/disable alarm
+void cmdToggleAlarm(uint8_t argc, char **argv)
+{
+  uint8_t index;
+  if (argc == 2 && parseUint8(argv[1], index) && validAlarmIndex(index, false))
+  {
+    toggleAlarm(index);
+    serialOut.print(F("OK:"));
+    serialOut.print(index);
+    serialOut.print(':');
+    serialOut.println(alarms[index].enabled ? 1 : 0);
+  }
+  else
+  {
+    serialOut.println(F("ERROR:INVALID_INDEX"));
+  }
+}
+
+// SET_DAYS:index:days - Which days an alarm rings (bit 0 = Sunday, 127 = every day)
+void cmdSetDays(uint8_t argc, char **argv)
+{
+  uint8_t index, days;
+  if (argc == 3 && parseUint8(argv[1], index) && parseUint8(argv[2], days) &&
+      validAlarmIndex(index, false) && days <= ALL_DAYS)
+  {
+    setAlarmDays(index, days);
+    serialOut.print(F("OK:"));
+    serialOut.print(index);
+    serialOut.print(':');
+    serialOut.println(days);
+  }
+  else
+  {
+    serialOut.println(F("ERROR:INVALID_PARAMS"));
+  }
+}
+
+// DELETE_ALARM:index - Remove an alarm (later alarms move up one index)
+void cmdDeleteAlarm(uint8_t argc, char **argv)
+{
+  uint8_t index;
+  if (argc == 2 && parseUint8(argv[1], index) && validAlarmIndex(index, false))
+  {
+    deleteAlarm(index);
+    serialOut.print(F("OK:"));
+    serialOut.println(index);
+  }
+  else
+  {
+    serialOut.println(F("ERROR:INVALID_INDEX"));
+  }
+}
+
+// BATCH_BEGIN:count - Start staging a schedule of `count` alarms. Starts
+// from the current alarms; any batch not committed yet is dropped.
+void cmdBatchBegin(uint8_t argc, char **argv)
+{
+  uint8_t count;
+  if (argc == 2 && parseUint8(argv[1], count) && count <= MAX_ALARMS)
+  {
+    batchBegin(count);
+    serialOut.print(F("OK:BATCH:"));
+    serialOut.println(count);
+  }
+  else
+  {
+    serialOut.println(F("ERROR:INVALID_PARAMS"));
+  }
+}
+
+// BATCH_SET:index:hour:minute:enabled:days - Stage one alarm
+void cmdBatchSet(uint8_t argc, char **argv)
+{
+  uint8_t index, hour, minute, enabled, days;
+  if (argc == 6 && parseUint8(argv[1], index) && parseUint8(argv[2], hour) &&
+      parseUint8(argv[3], minute) && parseUint8(argv[4], enabled) && parseUint8(argv[5], days) &&
+      batchSet(index, hour, minute, enabled, days))
+  {
+    serialOut.print(F("OK:STAGED:"));
+    serialOut.println(index);
+  }
+  else
+  {
+    batch.failed = true; // Unparsable lines spoil the batch as well
+    serialOut.println(batch.open ? F("ERROR:INVALID_PARAMS") : F("ERROR:NO_BATCH"));
+  }
+}
+
+// BATCH_COMMIT - Apply the staged schedule and save it once
+void cmdBatchCommit(uint8_t argc, char **argv)
+{
+  if (!batch.open)
+  {
+    serialOut.println(F("ERROR:NO_BATCH"));
+    return;
+  }
+  bool current = batchCurrent();
+  if (!batchCommit())
+  {
+    serialOut.println(current ? F("ERROR:BATCH_REJECTED") : F("ERROR:SCHEDULE_CHANGED"));
+    return;
+  }
+  serialOut.print(F("OK:COMMIT:"));
+  serialOut.print(alarmCount);
+  serialOut.print(':');
+  serialOut.println(configVersion());
+}
+
+// BATCH_ABORT - Drop the staged schedule
+void cmdBatchAbort(uint8_t argc, char **argv)
+{
+  batch.open = false;
+  serialOut.println(F("OK:ABORT"));
+}
+
+// GET_SNAPSHOT - Config version, status and schedule in one reply
+void cmdGetSnapshot(uint8_t argc, char **argv)
+{
+  // Format: SNAPSHOT:version:powered:hour:minute:dayOfWeek:count:hour:min:enabled:days:...
+  ClockTime now = clockNow();
+  serialOut.print(F("SNAPSHOT:"));
+  serialOut.print(configVersion());
+  serialOut.print(':');
+  serialOut.print(systemPowered ? 1 : 0);
+  serialOut.print(':');
+  serialOut.print(now.hour());
+  serialOut.print(':');
+  serialOut.print(now.minute());
+  serialOut.print(':');
+  serialOut.print(now.dayOfTheWeek());
+  serialOut.print(':');
+  serialOut.print(alarmCount);
+  for (uint8_t i = 0; i < alarmCount; i++)
+  {
+    serialOut.print(':');
+    serialOut.print(alarms[i].hour);
+    serialOut.print(':');
+    serialOut.print(alarms[i].minute);
+    serialOut.print(':');
+    serialOut.print(alarms[i].enabled ? 1 : 0);
+    serialOut.print(':');
+    serialOut.print(alarms[i].days);
+  }
+  serialOut.println();
+}
+
+// GET_STATUS - Get system status (online/offline, current time, etc)
+void cmdGetStatus(uint8_t argc, char **argv)
+{
+  ClockTime now = clockNow();
+  serialOut.print(F("STATUS:"));
+  serialOut.print(systemPowered ? 1 : 0);
+  serialOut.print(':');
+  serialOut.print(now.hour());
+  serialOut.print(':');
+  serialOut.print(now.minute());
+  serialOut.print(':');
+  serialOut.println(now.dayOfTheWeek());
+}
+
+// GET_OLED_STATS - I2C bytes/second to the display: sent vs full redraw
+void cmdGetOledStats(uint8_t argc, char **argv)
+{
+  serialOut.print(F("OLED:"));
+  serialOut.print(display.sentPerSec);
+  serialOut.print(':');
+  serialOut.print(display.fullPerSec);
+  serialOut.print(':');
+  serialOut.print(display.renderUs);
+  serialOut.print(':');
+  serialOut.println(display.ramBytes());
+}
+
+// GET_POWER - Awake duty cycle since the last GET_POWER (starts a new window)
+void cmdGetPower(uint8_t argc, char **argv)
+{
+  PowerStats stats;
+  powerTakeStats(powerWindowTicks, stats);
+  powerWindowTicks = 0;
+  serialOut.print(F("POWER:"));
+  serialOut.print(stats.awakePermille);
+  serialOut.print(':');
+  serialOut.print(stats.seconds);
+  serialOut.print(':');
+  serialOut.println(stats.downSleeps);
+}
+
+// GET_CLOCK - Software clock vs RTC at the last resync
+void cmdGetClock(uint8_t argc, char **argv)
+{
+  serialOut.print(F("CLOCK:"));
+  serialOut.print(softClock.lastErrorMs);
+  serialOut.print(':');
+  serialOut.print(softClock.driftPpm);
+  serialOut.print(':');
+  serialOut.print(softClock.syncCount);
+  serialOut.print(':');
+  serialOut.println(softClock.interval());
+}
+
+// SET_CLOCK_SYNC:minutes - How often the RTC is read (1-255 minutes)
+void cmdSetClockSync(uint8_t argc, char **argv)
+{
+  uint8_t minutes;
+  if (argc == 2 && parseUint8(argv[1], minutes) && minutes > 0)
+  {
+    softClock.setInterval(minutes);
+    serialOut.print(F("OK:"));
+    serialOut.println(minutes);
+  }
+  else
+  {
+    serialOut.println(F("ERROR:INVALID_PARAMS"));
+  }
+}
+
+// Events per GET_LOG reply - the host asks again while "more" is 1
+#define LOG_BATCH 7
+
+// GET_LOG:since - Dose events after sequence number `since` (0 = all)
+void cmdGetLog(uint8_t argc, char **argv)
+{
+  uint16_t since;
+  if (argc != 2 || !parseUint16(argv[1], since))
+  {
+    serialOut.println(F("ERROR:INVALID_PARAMS"));
+    return;
+  }
+
+  // Format: LOG:count:more:seq:type:time:lag:... (time = Unix seconds)
+  LogEvent page[LOG_BATCH];
+  bool more;
+  uint8_t count = eventLog.read(since, page, LOG_BATCH, more);
+  serialOut.print(F("LOG:"));
+  serialOut.print(count);
+  serialOut.print(':');
+  serialOut.print(more ? 1 : 0);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    serialOut.print(':');
+    serialOut.print(page[i].seq);
+    serialOut.print(':');
+    serialOut.print(page[i].type);
+    serialOut.print(':');
+    serialOut.print(page[i].minute * 60UL + CLOCK_UNIX_2000);
+    serialOut.print(':');
+    serialOut.print(page[i].lag);
+  }
+  serialOut.println();
+}
+
+// SUBSCRIBE / UNSUBSCRIBE - Pushed EVT: lines on every change (see event_stream.h)
+void cmdSubscribe(uint8_t argc, char **argv)
+{
+  events.subscribe(true);
+  serialOut.print(F("OK:SUBSCRIBE:"));
+  serialOut.println(events.lastSeq());
+}
+
+void cmdUnsubscribe(uint8_t argc, char **argv)
+{
+  events.subscribe(false);
+  serialOut.println(F("OK:UNSUBSCRIBE"));
+}
+
+// SET_BAUD:rate - Reply at the old rate, then switch (see serial_speed.h)
+void cmdSetBaud(uint8_t argc, char **argv)
+{
+  uint32_t rate;
+  if (argc != 2 || !parseUint32(argv[1], rate) || !baudSupported(rate))
+  {
+    serialOut.println(F("ERROR:INVALID_PARAMS"));
+    return;
+  }
+  serialOut.print(F("OK:BAUD:"));
+  serialOut.println((unsigned long)rate);
+  serialSpeed.request(rate);
+}
+
+#if PERF_STATS
+// GET_PERF - Loop histogram, section times, RX backlog, stack and RAM
+// headroom (see perf.h)
+void cmdGetPerf(uint8_t argc, char **argv)
+{
+  serialOut.print(F("PERF:"));
+  for (uint8_t i = 0; i < PERF_BUCKETS; i++)
+  {
+    if (i > 0)
+      serialOut.print(',');
+    serialOut.print(perf.loopHist[i]);
+  }
+  for (uint8_t i = 0; i < PERF_SECTION_COUNT; i++)
+  {
+    serialOut.print(':');
+    serialOut.print(perf.sections[i].avgUs());
+    serialOut.print(',');
+    serialOut.print(perf.sections[i].maxUs);
+  }
+  serialOut.print(':');
+  serialOut.print(perf.rxPeak);
+  serialOut.print(':');
+  serialOut.print(perfStackUnused());
+  serialOut.print(':');
+  serialOut.print(perfFreeRam());
+  serialOut.print(':');
+  serialOut.println(perf.minFreeRam);
+}
+
+// RESET_PERF - Start all counters over
+void cmdResetPerf(uint8_t argc, char **argv)
+{
+  perfReset();
+  serialOut.println(F("OK:PERF_RESET"));
+}
+#endif
+
+// ---- Binary protocol (see binary_link.h for the frame format) ----
+// Opcodes and payloads mirror the text commands one-to-one.
+#define OP_GET_ALARMS 0x01     // -> count, then hour:minute:enabled per alarm
+#define OP_SET_ALARM 0x02      // index, hour, minute -> index, hour, minute
+#define OP_TOGGLE_ALARM 0x03   // index -> index, enabled
+#define OP_GET_STATUS 0x04     // -> powered, hour, minute, dayOfWeek
+#define OP_GET_OLED_STATS 0x05 // -> sent B/s, full B/s, render us (u32 LE each), RAM (u16 LE)
+#define OP_SET_DAYS 0x06       // index, days -> index, days
+#define OP_DELETE_ALARM 0x07   // index -> index, new count
+#define OP_GET_SCHEDULE 0x08   // -> count, then hour:minute:(days | enabled << 7)
+#define OP_GET_POWER 0x09      // -> awake permille, seconds, power-downs (u16 LE each)
+#define OP_GET_CLOCK 0x0A      // -> error ms (i32 LE), drift ppm (i32 LE), syncs (u16 LE), interval
+#define OP_SET_CLOCK_SYNC 0x0B // minutes -> minutes
+#define OP_GET_LOG 0x0C        // since (u16 LE) -> count, more, then seq (u16), type, lag, time (u32) per event
+#define OP_SUBSCRIBE 0x0D      // on -> on, last event seq (u16 LE)
+#define OP_SET_BAUD 0x0E       // rate (u32 LE) -> rate, then switches
+#define OP_GET_PERF 0x0F       // -> loop histogram (u16 LE x 10), avg us (u16 LE) + max us (u32 LE) per section, RX peak, stack unused, free RAM, least free RAM (u16 LE)
+#define OP_RESET_PERF 0x10     // -> (empty)
+#define OP_GET_SNAPSHOT 0x11   // -> version (u16 LE), powered, hour, minute, dayOfWeek, count, then hour:minute:(days | enabled << 7)
+#define OP_SET_SCHEDULE 0x12   // count, then hour:minute:(days | enabled << 7) x MAX_ALARMS (unused ones 0) -> count, version (u16 LE)
+#define OP_TEXT_MODE 0x7F      // -> (empty), then back to text commands
+
+uint8_t binGetAlarms(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  resp[respLen++] = alarmCount;
+  for (uint8_t i = 0; i < alarmCount; i++)
+  {
+    resp[respLen++] = alarms[i].hour;
+    resp[respLen++] = alarms[i].minute;
+    resp[respLen++] = alarms[i].enabled ? 1 : 0;
+  }
+  return BIN_OK;
+}
+
+uint8_t binSetAlarm(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  if (!validAlarmIndex(req[0], true) || req[1] >= 24 || req[2] >= 60)
+    return BIN_ERR_INVALID_PARAMS;
+  setAlarm(req[0], req[1], req[2]);
+  resp[respLen++] = req[0];
+  resp[respLen++] = req[1];
+  resp[respLen++] = req[2];
+  return BIN_OK;
+}
+
+uint8_t binToggleAlarm(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  if (!validAlarmIndex(req[0], false))
+    return BIN_ERR_INVALID_PARAMS;
+  toggleAlarm(req[0]);
+  resp[respLen++] = req[0];
+  resp[respLen++] = alarms[req[0]].enabled ? 1 : 0;
+  return BIN_OK;
+}
+
+uint8_t binSetDays(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  if (!validAlarmIndex(req[0], false) || req[1] > ALL_DAYS)
+    return BIN_ERR_INVALID_PARAMS;
+  setAlarmDays(req[0], req[1]);
+  resp[respLen++] = req[0];
+  resp[respLen++] = req[1];
+  return BIN_OK;
+}
+
+uint8_t binDeleteAlarm(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  if (!validAlarmIndex(req[0], false))
+    return BIN_ERR_INVALID_PARAMS;
+  deleteAlarm(req[0]);
+  resp[respLen++] = req[0];
+  resp[respLen++] = alarmCount;
+  return BIN_OK;
+}
+
+uint8_t binGetSchedule(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  resp[respLen++] = alarmCount;
+  for (uint8_t i = 0; i < alarmCount; i++)
+  {
+    resp[respLen++] = alarms[i].hour;
+    resp[respLen++] = alarms[i].minute;
+    resp[respLen++] = alarms[i].days | (alarms[i].enabled ? 0x80 : 0);
+  }
+  return BIN_OK;
+}
+
+uint8_t binGetStatus(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  ClockTime now = clockNow();
+  resp[respLen++] = systemPowered ? 1 : 0;
+  resp[respLen++] = now.hour();
+  resp[respLen++] = now.minute();
+  resp[respLen++] = now.dayOfTheWeek();
+  return BIN_OK;
+}
+
+void putU16(uint8_t *resp, uint8_t &respLen, uint16_t v);
+
+uint8_t binGetSnapshot(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  ClockTime now = clockNow();
+  putU16(resp, respLen, configVersion());
+  resp[respLen++] = systemPowered ? 1 : 0;
+  resp[respLen++] = now.hour();
+  resp[respLen++] = now.minute();
+  resp[respLen++] = now.dayOfTheWeek();
+  return binGetSchedule(req, resp, respLen);
+}
+
+// The whole schedule in one frame - checked completely before anything
+// changes
+uint8_t binSetSchedule(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  uint8_t count = req[0];
+  if (count > MAX_ALARMS)
+    return BIN_ERR_INVALID_PARAMS;
+  Alarm list[MAX_ALARMS];
+  for (uint8_t i = 0; i < count; i++)
+  {
+    const uint8_t *a = req + 1 + i * 3;
+    if (!validAlarm(a[0], a[1], a[2] >> 7, a[2] & ALL_DAYS))
+      return BIN_ERR_INVALID_PARAMS;
+    list[i].hour = a[0];
+    list[i].minute = a[1];
+    list[i].days = a[2] & ALL_DAYS;
+    list[i].enabled = a[2] >> 7;
+  }
+  setSchedule(list, count);
+  resp[respLen++] = alarmCount;
+  putU16(resp, respLen, configVersion());
+  return BIN_OK;
+}
+
+void putU32(uint8_t *resp, uint8_t &respLen, uint32_t v)
+{
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    resp[respLen++] = v & 0xFF;
+    v >>= 8;
+  }
+}
+
+void putU16(uint8_t *resp, uint8_t &respLen, uint16_t v)
+{
+  resp[respLen++] = v & 0xFF;
+  resp[respLen++] = v >> 8;
+}
+
+uint8_t binGetOledStats(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  putU32(resp, respLen, display.sentPerSec);
+  putU32(resp, respLen, display.fullPerSec);
+  putU32(resp, respLen, display.renderUs);
+  putU16(resp, respLen, display.ramBytes());
+  return BIN_OK;
+}
+
+uint8_t binGetPower(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  PowerStats stats;
+  powerTakeStats(powerWindowTicks, stats);
+  powerWindowTicks = 0;
+  putU16(resp, respLen, stats.awakePermille);
+  putU16(resp, respLen, stats.seconds);
+  putU16(resp, respLen, stats.downSleeps);
+  return BIN_OK;
+}
+
+uint8_t binGetClock(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  putU32(resp, respLen, (uint32_t)softClock.lastErrorMs);
+  putU32(resp, respLen, (uint32_t)softClock.driftPpm);
+  putU16(resp, respLen, softClock.syncCount);
+  resp[respLen++] = softClock.interval();
+  return BIN_OK;
+}
 
-// ==================== EEPROM FUNCTIONS ====================
-void saveAlarms()
+uint8_t binSetClockSync(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
 {
-  for (uint8_t i = 0; i < 3; i++)
-  {
-    EEPROM.write(i * 3, alarms[i].hour);
-    EEPROM.write(i * 3 + 1, alarms[i].minute);
-    EEPROM.write(i * 3 + 2, alarms[i].enabled);
-  }
+  if (req[0] == 0)
+    return BIN_ERR_INVALID_PARAMS;
+  softClock.setInterval(req[0]);
+  resp[respLen++] = req[0];
+  return BIN_OK;
 }
 
-void loadAlarms()
+uint8_t binGetLog(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
 {
-  if (EEPROM.read(0) <= 23)
+  LogEvent page[LOG_BATCH];
+  bool more;
+  uint8_t count = eventLog.read(req[0] | ((uint16_t)req[1] << 8), page, LOG_BATCH, more);
+  resp[respLen++] = count;
+  resp[respLen++] = more ? 1 : 0;
+  for (uint8_t i = 0; i < count; i++)
   {
-    for (uint8_t i = 0; i < 3; i++)
-    {
-      alarms[i].hour = EEPROM.read(i * 3);
-      alarms[i].minute = EEPROM.read(i * 3 + 1);
-      alarms[i].enabled = EEPROM.read(i * 3 + 2);
-    }
+    putU16(resp, respLen, page[i].seq);
+    resp[respLen++] = page[i].type;
+    resp[respLen++] = page[i].lag;
+    putU32(resp, respLen, page[i].minute * 60UL + CLOCK_UNIX_2000);
   }
-  else
+  return BIN_OK;
+}
+
+#if PERF_STATS
+uint8_t binGetPerf(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  for (uint8_t i = 0; i < PERF_BUCKETS; i++)
+    putU16(resp, respLen, perf.loopHist[i]);
+  for (uint8_t i = 0; i < PERF_SECTION_COUNT; i++)
   {
-    saveAlarms();
+    putU16(resp, respLen, perf.sections[i].avgUs());
+    putU32(resp, respLen, perf.sections[i].maxUs);
   }
+  resp[respLen++] = perf.rxPeak;
+  putU16(resp, respLen, perfStackUnused());
+  putU16(resp, respLen, perfFreeRam());
+  putU16(resp, respLen, perf.minFreeRam);
+  return BIN_OK;
 }
 
-// ==================== SERIAL COMMUNICATION ====================
-// LEARNING NOTE: Serial communication allows Arduino to talk to computer/website
-// Commands format: "COMMAND:param1:param2:param3"
-// This lets us control Arduino from the dashboard!
+uint8_t binResetPerf(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  perfReset();
+  return BIN_OK;
+}
+#endif
+
+uint8_t binSubscribe(const uint8_t *req, uint8_t *resp, uint8_t &respLen);
+uint8_t binSetBaud(const uint8_t *req, uint8_t *resp, uint8_t &respLen);
+uint8_t binTextMode(const uint8_t *req, uint8_t *resp, uint8_t &respLen);
+
+const BinaryCommandEntry binaryTable[] PROGMEM = {
+    {OP_GET_ALARMS, 0, binGetAlarms},
+    {OP_SET_ALARM, 3, binSetAlarm},
+    {OP_TOGGLE_ALARM, 1, binToggleAlarm},
+    {OP_GET_STATUS, 0, binGetStatus},
+    {OP_GET_OLED_STATS, 0, binGetOledStats},
+    {OP_SET_DAYS, 2, binSetDays},
+    {OP_DELETE_ALARM, 1, binDeleteAlarm},
+    {OP_GET_SCHEDULE, 0, binGetSchedule},
+    {OP_GET_POWER, 0, binGetPower},
+    {OP_GET_CLOCK, 0, binGetClock},
+    {OP_SET_CLOCK_SYNC, 1, binSetClockSync},
+    {OP_GET_LOG, 2, binGetLog},
+    {OP_SUBSCRIBE, 1, binSubscribe},
+    {OP_SET_BAUD, 4, binSetBaud},
+#if PERF_STATS
+    {OP_GET_PERF, 0, binGetPerf},
+    {OP_RESET_PERF, 0, binResetPerf},
+#endif
+    {OP_GET_SNAPSHOT, 0, binGetSnapshot},
+    {OP_SET_SCHEDULE, 1 + 3 * MAX_ALARMS, binSetSchedule},
+    {OP_TEXT_MODE, 0, binTextMode},
+};
+
+BinaryLink binaryLink(binaryTable, sizeof(binaryTable) / sizeof(binaryTable[0]));
+EventStream events(binaryLink, serialOut);
+
+uint8_t binSubscribe(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  if (req[0] > 1)
+    return BIN_ERR_INVALID_PARAMS;
+  events.subscribe(req[0]);
+  resp[respLen++] = req[0];
+  putU16(resp, respLen, events.lastSeq());
+  return BIN_OK;
+}
+
+uint8_t binSetBaud(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  uint32_t rate = req[0] | ((uint32_t)req[1] << 8) | ((uint32_t)req[2] << 16) | ((uint32_t)req[3] << 24);
+  if (!baudSupported(rate))
+    return BIN_ERR_INVALID_PARAMS;
+  putU32(resp, respLen, rate);
+  serialSpeed.request(rate); // Takes effect once this reply is sent
+  return BIN_OK;
+}
+
+uint8_t binTextMode(const uint8_t *req, uint8_t *resp, uint8_t &respLen)
+{
+  binaryLink.end(); // Takes effect once this reply is sent
+  return BIN_OK;
+}
+
+// BINARY - Switch to the binary protocol until OP_TEXT_MODE
+void cmdBinary(uint8_t argc, char **argv)
+{
+  serialOut.println(F("OK:BINARY"));
+  binaryLink.begin();
+}
+
+// Command table (in Flash). To add a command: write a cmdXxx() function
+// above and add one line here.
+const CommandEntry commandTable[] PROGMEM = {
+    {"GET_ALARMS", cmdGetAlarms},
+    {"SET_ALARM", cmdSetAlarm},
+    {"TOGGLE_ALARM", cmdToggleAlarm},
+    {"GET_STATUS", cmdGetStatus},
+    {"GET_OLED_STATS", cmdGetOledStats},
+    {"GET_SCHEDULE", cmdGetSchedule},
+    {"GET_SNAPSHOT", cmdGetSnapshot},
+    {"BATCH_BEGIN", cmdBatchBegin},
+    {"BATCH_SET", cmdBatchSet},
+    {"BATCH_COMMIT", cmdBatchCommit},
+    {"BATCH_ABORT", cmdBatchAbort},
+    {"SET_DAYS", cmdSetDays},
+    {"DELETE_ALARM", cmdDeleteAlarm},
+    {"GET_POWER", cmdGetPower},
+    {"GET_CLOCK", cmdGetClock},
+    {"SET_CLOCK_SYNC", cmdSetClockSync},
+    {"GET_LOG", cmdGetLog},
+    {"SUBSCRIBE", cmdSubscribe},
+    {"UNSUBSCRIBE", cmdUnsubscribe},
+    {"SET_BAUD", cmdSetBaud},
+#if PERF_STATS
+    {"GET_PERF", cmdGetPerf},
+    {"RESET_PERF", cmdResetPerf},
+#endif
+    {"BINARY", cmdBinary},
+};
 
+CommandReader serialReader(commandTable, sizeof(commandTable) / sizeof(commandTable[0]));
+
+// Don't let a flood of bytes hold up the rest of loop()
+#define SERIAL_MAX_BYTES_PER_LOOP 64
+
+// Runs every loop() pass - only takes bytes that already arrived, never waits.
+// Bytes are routed one at a time so a mode switch applies from the very
+// next byte, even if the host already sent binary frames behind it.
 void handleSerialCommands()
 {
-  if (Serial.available() > 0)
+  PERF_SCOPE(PERF_SERIAL);
+  PERF_RX_BACKLOG(Serial.available());
+  serialOut.service();
+
+  // Whatever a byte completes is answered as one unit (see serial_out.h).
+  // No room for another reply: leave the bytes in the RX buffer for now.
+  uint8_t budget = SERIAL_MAX_BYTES_PER_LOOP;
+  while (budget-- && Serial.available() > 0 && serialOut.room() >= SEROUT_REPLY_ROOM)
   {
-    String command = Serial.readStringUntil('\n');
-    command.trim(); // Remove whitespace
-
-    // GET_ALARMS - Send all alarm data to website
-    if (command == "GET_ALARMS")
+    uint8_t c = (uint8_t)Serial.read();
+    lastSerialActivity = halMillis();
+    serialOut.begin();
+    bool valid = binaryLink.active() ? binaryLink.feed(c, serialOut) : serialReader.feed(c);
+    serialOut.end();
+
+    // Something arrived intact, so the host is at our rate: keep it
+    if (valid && serialSpeed.confirm())
     {
-      // Format: ALARMS:hour1:min1:enabled1:hour2:min2:enabled2:hour3:min3:enabled3
-      Serial.print(F("ALARMS:"));
-      for (uint8_t i = 0; i < 3; i++)
-      {
-        Serial.print(alarms[i].hour);
-        Serial.print(':');
-        Serial.print(alarms[i].minute);
-        Serial.print(':');
-        Serial.print(alarms[i].enabled ? 1 : 0);
-        if (i < 2)
-          Serial.print(':');
-      }
-      Serial.println();
+      settings.baud = serialSpeed.rate();
+      saveSettings();
+      LOG_INFO(LOG_SYSTEM, "Serial rate confirmed");
     }
-    // SET_ALARM:index:hour:minute - Update specific alarm
-    // Example: "SET_ALARM:0:9:30" sets Morning alarm to 9:30 AM
-    else if (command.startsWith("SET_ALARM:"))
-    {
-      // Parse the command
-      int firstColon = command.indexOf(':', 10);
-      int secondColon = command.indexOf(':', firstColon + 1);
-      int thirdColon = command.indexOf(':', secondColon + 1);
 
-      uint8_t index = command.substring(10, firstColon).toInt();
-      uint8_t hour = command.substring(firstColon + 1, secondColon).toInt();
-      uint8_t minute = command.substring(secondColon + 1).toInt();
-
-      // Validate input
-      if (index < 3 && hour < 24 && minute < 60)
-      {
-        alarms[index].hour = hour;
-        alarms[index].minute = minute;
-        saveAlarms(); // Save to EEPROM immediately!
-
-        Serial.print(F("OK:"));
-        Serial.print(index);
-        Serial.print(':');
-        Serial.print(hour);
-        Serial.print(':');
-        Serial.println(minute);
-      }
-      else
-      {
-        Serial.println(F("ERROR:INVALID_PARAMS"));
-      }
-    }
-    // TOGGLE_ALARM:index - Enable/disable alarm
-    else if (command.startsWith("TOGGLE_ALARM:"))
+    // SET_BAUD was just answered. Whatever follows was sent at the new rate.
+    if (serialSpeed.apply())
     {
-      uint8_t index = command.substring(13).toInt();
-      if (index < 3)
+      serialReader.reset();
+      if (!serialSpeed.onProbation()) // Back to BAUD_DEFAULT needs no check
       {
-        alarms[index].enabled = !alarms[index].enabled;
-        saveAlarms();
-        Serial.print(F("OK:"));
-        Serial.print(index);
-        Serial.print(':');
-        Serial.println(alarms[index].enabled ? 1 : 0);
+        settings.baud = BAUD_DEFAULT;
+        saveSettings();
       }
-      else
-      {
-        Serial.println(F("ERROR:INVALID_INDEX"));
-      }
-    }
-    // GET_STATUS - Get system status (online/offline, current time, etc)
-    else if (command == "GET_STATUS")
-    {
-      DateTime now = rtc.now();
-      Serial.print(F("STATUS:"));
-      Serial.print(systemPowered ? 1 : 0);
-      Serial.print(':');
-      Serial.print(now.hour());
-      Serial.print(':');
-      Serial.print(now.minute());
-      Serial.print(':');
-      Serial.println(now.dayOfTheWeek());
-    }
-    else
-    {
-      Serial.println(F("ERROR:UNKNOWN_COMMAND"));
+      break;
     }
   }
+
+  // No word from the host at the new rate: fall back to BAUD_DEFAULT
+  if (serialSpeed.poll())
+  {
+    serialReader.reset();
+    LOG_WARN(LOG_SYSTEM, "No reply at the new serial rate, back to 9600");
+  }
 }
 
 // ==================== BUTTON FUNCTIONS ====================
-bool btnPressed(uint8_t pin)
-{
-  if (digitalRead(pin) == LOW)
-  {
-    Serial.print(F("BUTTON PRESSED: Pin "));
-    Serial.println(pin);
-    unsigned long now = millis();
-    if (now - lastBtn > 100)
-    { // Reduced from 200ms to 100ms for better responsiveness
-      lastBtn = now;
-      delay(20); // Reduced from 50ms to 20ms
-      if (digitalRead(pin) == LOW)
-      {
-        Serial.println(F("BUTTON CONFIRMED!"));
-        // Wait for button release to avoid multiple triggers
-        while (digitalRead(pin) == LOW)
-        {
-          delay(10);
-        }
-        return true;
-      }
+// Buttons are read by pin-change interrupts (see buttons.h). At the start
+// of every loop() pass pollButtons() collects the debounced presses, and
+// btnPressed() hands each press out exactly once.
+
+// Indexed by ButtonId
+const uint8_t buttonPins[BTN_COUNT] = {upbtn, downbtn, setbtn, confirmbtn, homebtn, powerswitch};
+
+// Buttons pressed since the start of this loop() pass (bit per ButtonId)
+uint8_t pressedButtons = 0;
+
+void pollButtons()
+{
+  pressedButtons = 0;
+  ButtonEvent ev;
+  while (buttonsNextEvent(ev))
+  {
+    if (ev.type == BTN_EVENT_PRESS && ev.button != BTN_POWER)
+    {
+      pressedButtons |= (1 << ev.button);
+      LOG_DEBUG(LOG_BUTTON, "BUTTON PRESSED: Pin %u", buttonPins[ev.button]);
     }
   }
+}
+
+// True once per press - asking again in the same pass returns false
+bool btnPressed(uint8_t button)
+{
+  if (pressedButtons & (1 << button))
+  {
+    pressedButtons &= ~(1 << button);
+    return true;
+  }
   return false;
 }
 
@@ -242,25 +1218,23 @@ void printTime(uint8_t h, uint8_t m)
   display.print(pm ? F(" PM") : F(" AM"));
 }
 
-// ==================== ALARM CHECK ====================
-bool checkAlarm(DateTime &now, uint8_t &idx)
+// ==================== DISPLAY FUNCTIONS ====================
+// Dose names in Flash. With any number of alarms the name comes from the
+// time of day: before noon MORNING, before 5 PM AFTERNOON, else EVENING.
+const char doseMorning[] PROGMEM = "MORNING";
+const char doseAfternoon[] PROGMEM = "AFTERNOON";
+const char doseEvening[] PROGMEM = "EVENING";
+
+const char *doseName(uint8_t hour)
 {
-  for (uint8_t i = 0; i < 3; i++)
-  {
-    if (alarms[i].enabled &&
-        now.hour() == alarms[i].hour &&
-        now.minute() == alarms[i].minute &&
-        now.second() == 0)
-    {
-      idx = i;
-      return true;
-    }
-  }
-  return false;
+  if (hour < 12)
+    return doseMorning;
+  if (hour < 17)
+    return doseAfternoon;
+  return doseEvening;
 }
 
-// ==================== DISPLAY FUNCTIONS ====================
-void showReminder(uint8_t idx)
+void showReminder(uint8_t hour, uint8_t minute)
 {
   display.clearDisplay();
   display.setTextSize(1);
@@ -269,141 +1243,321 @@ void showReminder(uint8_t idx)
 
   display.setTextSize(2);
   display.setCursor(0, 20);
-  if (idx == 0)
-    display.println(F("MORNING"));
-  else if (idx == 1)
-    display.println(F("AFTERNOON"));
-  else
-    display.println(F("EVENING"));
+  display.println((const __FlashStringHelper *)doseName(hour));
 
   display.setTextSize(1);
   display.setCursor(0, 50);
-  printTime(alarms[idx].hour, alarms[idx].minute);
-  display.display();
+  printTime(hour, minute);
+  display.flush();
+}
+
+// Short confirmation screens ("CANCELLED", "SAVED!") stay up for a while.
+// They used to be a halDelay() that held up loop(): serial commands, the
+// power switch and a ringing reminder all waited. Now the caller draws the
+// screen and holdScreen() keeps the clock and reminder screens off it
+// until the time is up, while loop() carries on. A button press, an alarm
+// or switching off ends it early.
+unsigned long screenHoldEnd = 0;
+bool screenHoldActive = false;
+
+void holdScreen(unsigned long ms)
+{
+  screenHoldEnd = halMillis() + ms;
+  screenHoldActive = true;
+}
+
+void releaseScreen()
+{
+  screenHoldActive = false;
+}
+
+// True while a held screen should stay up
+bool screenHeld()
+{
+  if (screenHoldActive && (long)(halMillis() - screenHoldEnd) >= 0)
+    screenHoldActive = false;
+  return screenHoldActive;
 }
 
-// Blink only TODAY's LED (not all 7)
-void blinkTodayLED(uint8_t dayIdx)
+// ==================== REMINDER STATE MACHINE ====================
+// LEARNING NOTE: The reminder used to be two blocking while() loops that
+// kept the Arduino busy for up to 15 minutes. Now it is a small state
+// machine: loop() calls serviceReminder() on every pass and each phase
+// just compares millis() against its deadline. Serial commands, the power
+// switch and the menu keep working while the buzzer is going.
+enum ReminderPhase
+{
+  REMINDER_IDLE,
+  REMINDER_URGENT, // First minute: beep every second
+  REMINDER_SNOOZE, // Until 15 minutes: short beep every 2 minutes
+  REMINDER_RESULT  // Showing "DOSE TAKEN" / "MISSED" screen
+};
+
+// The beeps themselves are BUZZ_URGENT / BUZZ_SNOOZE (see buzzer.h), which
+// the Timer2 interrupt plays on its own once startReminder() kicks it off.
+const unsigned long URGENT_PHASE_MS = BUZZER_URGENT_MS; // 1 minute
+const unsigned long REMINDER_TIMEOUT_MS = 900000UL;     // 15 minutes
+const unsigned long TAKEN_SCREEN_MS = 2000UL;
+const unsigned long MISSED_SCREEN_MS = 3000UL;
+
+struct Reminder
 {
-  static unsigned long lastBlink = 0;
-  static bool state = false;
+  ReminderPhase phase;
+  uint8_t hour;             // Dose time (copied - alarms[] may change meanwhile)
+  uint8_t minute;
+  uint8_t dayIdx;           // Today's LED
+  unsigned long start;      // millis() when the alarm fired
+  uint32_t startSec;        // clockSeconds() then - millis() restarts at reset
+  unsigned long resultEnd;  // millis() when the result screen ends
+};
+Reminder reminder = {REMINDER_IDLE, 0, 0, 0, 0, 0, 0};
+
+// Alarms that came due while another reminder was active, oldest first
+struct PendingDose
+{
+  uint8_t hour;
+  uint8_t minute;
+};
+PendingDose pendingDoses[MAX_ALARMS];
+uint8_t pendingCount = 0;
 
-  if (millis() - lastBlink > 500)
+void showMenu(); // Defined in the menu section below
+
+// Mirror the reminder to EEPROM (nothing is written if it didn't change)
+void saveCheckpoint()
+{
+  ReminderCheckpoint cp = {0, 0, 0, 0, REMINDER_IDLE};
+  if (reminder.phase == REMINDER_URGENT || reminder.phase == REMINDER_SNOOZE)
   {
-    state = !state;
-    // Turn off all LEDs first
-    for (uint8_t i = 0; i < 7; i++)
-    {
-      digitalWrite(ledPins[i], LOW);
-    }
-    // Blink only today's LED
-    digitalWrite(ledPins[dayIdx], state);
-    lastBlink = millis();
+    cp.start = reminder.startSec;
+    cp.hour = reminder.hour;
+    cp.minute = reminder.minute;
+    cp.dayIdx = reminder.dayIdx;
+    cp.phase = reminder.phase;
   }
+  checkpointStore.save(&cp, sizeof(cp));
 }
 
-void triggerAlarm(uint8_t idx)
+// Record how the current reminder ended (see event_log.h)
+void logDose(uint8_t type)
 {
-  unsigned long start = millis();
+  uint32_t minute = clockSeconds() / 60;
+  uint16_t dose = reminder.hour * 60 + reminder.minute;
+  uint16_t lag = (minute % 1440 + 1440 - dose) % 1440;
+  eventLog.append(type, minute, lag > 255 ? 255 : lag);
+}
 
-  Serial.print(F("ALARM: "));
-  if (idx == 0)
-    Serial.println(F("MORNING"));
-  else if (idx == 1)
-    Serial.println(F("AFTERNOON"));
-  else
-    Serial.println(F("EVENING"));
+void startReminder(uint8_t hour, uint8_t minute, uint8_t dayIdx)
+{
+  if (reminder.phase != REMINDER_IDLE)
+  {
+    // Don't lose it - run it as soon as the current one is finished
+    if (pendingCount < MAX_ALARMS)
+    {
+      pendingDoses[pendingCount].hour = hour;
+      pendingDoses[pendingCount].minute = minute;
+      pendingCount++;
+    }
+    LOG_INFO(LOG_ALARM, "ALARM QUEUED: " LOG_PSTR " %02u:%02u", doseName(hour), hour, minute);
+    return;
+  }
 
-  // Calculate today's day index for LED (DIRECT mapping)
-  DateTime now = rtc.now();
-  uint8_t rtcDay = now.dayOfTheWeek();
-  uint8_t dayIdx = rtcDay;  // Direct mapping - no reversal needed
+  LOG_INFO(LOG_ALARM, "ALARM: " LOG_PSTR " %02u:%02u", doseName(hour), hour, minute);
+  LOG_DEBUG(LOG_LED, "Alarm - RTC Day: %u → Blinking LED Index: %u → Pin %u",
+            dayIdx, dayIdx, ledPins[dayIdx]);
 
-  Serial.print(F("Alarm - RTC Day: "));
-  Serial.print(rtcDay);
-  Serial.print(F(" → Blinking LED Index: "));
-  Serial.print(dayIdx);
-  Serial.print(F(" → Pin "));
-  Serial.println(ledPins[dayIdx]);
+  events.push(PUSH_ALARM, hour, minute);
+  releaseScreen(); // The reminder takes over the screen
+
+  unsigned long t = halMillis();
+  reminder.phase = REMINDER_URGENT;
+  reminder.hour = hour;
+  reminder.minute = minute;
+  reminder.dayIdx = dayIdx;
+  reminder.start = t;
+  reminder.startSec = clockSeconds();
+  buzzerPlay(BUZZ_URGENT); // First beep right away
+  saveCheckpoint();
 
   // 1 minute urgent phase
-  Serial.println(F(">>> BUZZER SHOULD BE BEEPING NOW! Check browser audio."));
-  while (millis() - start < 60000)
-  {
-    digitalWrite(buzzer, HIGH);
-    delay(200);
-    digitalWrite(buzzer, LOW);
-    delay(800);
+  LOG_DEBUG(LOG_ALARM, ">>> BUZZER SHOULD BE BEEPING NOW! Check browser audio.");
+}
+
+// Stop the buzzer and all LEDs, then show the result screen for a while
+void finishReminder(bool taken)
+{
+  if (taken)
+    buzzerPlay(BUZZ_CONFIRM);
+  else
+    buzzerStop();
+  ledsShow(0);
 
-    blinkTodayLED(dayIdx); // Blink only today's LED
-    showReminder(idx);
+  display.clearDisplay();
+  display.setTextSize(2);
+  if (taken)
+  {
+    display.setCursor(10, 20);
+    display.println(F("DOSE"));
+    display.println(F("TAKEN!"));
+    reminder.resultEnd = halMillis() + TAKEN_SCREEN_MS;
 
-    if (btnPressed(confirmbtn))
+    if (reminder.phase == REMINDER_URGENT)
+    {
+      LOG_INFO(LOG_ALARM, "STATUS: Dose Taken");
+      logDose(EVT_TAKEN);
+      events.push(PUSH_TAKEN, reminder.hour, reminder.minute);
+    }
+    else
     {
-      digitalWrite(buzzer, LOW);
-      for (uint8_t i = 0; i < 7; i++)
-        digitalWrite(ledPins[i], LOW);
+      LOG_INFO(LOG_ALARM, "STATUS: Dose Taken (Late)");
+      logDose(EVT_LATE);
+      events.push(PUSH_LATE, reminder.hour, reminder.minute);
+    }
+  }
+  else
+  {
+    display.setCursor(10, 10);
+    display.println(F("MISSED"));
+    display.println(F("DOSE!"));
+    reminder.resultEnd = halMillis() + MISSED_SCREEN_MS;
+
+    LOG_INFO(LOG_ALARM, "STATUS: MISSED DOSE");
+    logDose(EVT_MISSED);
+    events.push(PUSH_MISSED, reminder.hour, reminder.minute);
+  }
 
-      display.clearDisplay();
-      display.setTextSize(2);
-      display.setCursor(10, 20);
-      display.println(F("DOSE"));
-      display.println(F("TAKEN!"));
-      display.display();
-      delay(2000);
+  // Don't cover the menu if the user is in the middle of editing
+  if (menu == NORMAL)
+    display.flush();
+  else
+    showMenu();
 
-      Serial.println(F("STATUS: Dose Taken"));
-      return;
-    }
+  reminder.phase = REMINDER_RESULT;
+  saveCheckpoint();
+}
+
+// Drop any active or queued reminder (used when the system is switched off)
+void cancelReminder()
+{
+  if (reminder.phase == REMINDER_URGENT || reminder.phase == REMINDER_SNOOZE)
+  {
+    LOG_INFO(LOG_ALARM, "STATUS: Reminder cancelled");
+    logDose(EVT_CANCELLED);
+    events.push(PUSH_CANCELLED, reminder.hour, reminder.minute);
   }
+  buzzerStop();
+  reminder.phase = REMINDER_IDLE;
+  pendingCount = 0;
+  saveCheckpoint();
+}
 
-  // 14 minute snooze
-  digitalWrite(buzzer, LOW);
-  while (millis() - start < 900000)
+// After a reset: pick the checkpointed reminder up again, as far into its
+// 15 minutes as the RTC says we are. Alarms still queued behind it are not
+// in the checkpoint - those that are less than ALARM_LATE_WINDOW_MIN old
+// come due again from the alarm index. Returns true if one is running.
+bool resumeReminder(bool poweredOn)
+{
+  ReminderCheckpoint cp;
+  if (!checkpointStore.load(&cp, sizeof(cp)) || cp.start == 0)
+    return false;
+
+  reminder.phase = (ReminderPhase)cp.phase;
+  reminder.hour = cp.hour;
+  reminder.minute = cp.minute;
+  reminder.dayIdx = cp.dayIdx < 7 ? cp.dayIdx : 0;
+  reminder.startSec = cp.start;
+
+  // Switched off meanwhile - same as switching off while it rang
+  if (!poweredOn)
   {
-    if ((millis() - start) % 120000 < 100)
-    {
-      digitalWrite(buzzer, HIGH);
-      delay(100);
-      digitalWrite(buzzer, LOW);
-    }
+    cancelReminder();
+    return false;
+  }
 
-    blinkTodayLED(dayIdx); // Continue blinking today's LED
-    showReminder(idx);
+  uint32_t now = clockSeconds();
+  uint32_t elapsed = (now > cp.start) ? now - cp.start : 0;
+  if (elapsed > REMINDER_TIMEOUT_MS / 1000)
+    elapsed = REMINDER_TIMEOUT_MS / 1000; // serviceReminder() ends it as missed
 
-    if (btnPressed(confirmbtn))
-    {
-      for (uint8_t i = 0; i < 7; i++)
-        digitalWrite(ledPins[i], LOW);
+  reminder.phase = (elapsed * 1000UL < URGENT_PHASE_MS) ? REMINDER_URGENT : REMINDER_SNOOZE;
+  reminder.start = halMillis() - elapsed * 1000UL;
+  if (elapsed * 1000UL < REMINDER_TIMEOUT_MS)
+    buzzerPlay(BUZZ_URGENT, elapsed * 1000UL);
 
-      display.clearDisplay();
-      display.setTextSize(2);
-      display.setCursor(10, 20);
-      display.println(F("DOSE"));
-      display.println(F("TAKEN!"));
-      display.display();
-      delay(2000);
+  // Don't ring the same dose again if the reset came within its minute
+  alarmIndex.rebuild(alarms, alarmCount, cp.start / 60 + 1);
+
+  LOG_INFO(LOG_ALARM, "ALARM RESUMED: " LOG_PSTR " %02u:%02u, %lu s in",
+           doseName(reminder.hour), reminder.hour, reminder.minute, (unsigned long)elapsed);
+  return true;
+}
+
+// Called once per loop() pass while the system is ON. Never blocks.
+void serviceReminder()
+{
+  if (reminder.phase == REMINDER_IDLE)
+    return;
 
-      Serial.println(F("STATUS: Dose Taken (Late)"));
+  unsigned long t = halMillis();
+
+  if (reminder.phase == REMINDER_RESULT)
+  {
+    if ((long)(t - reminder.resultEnd) < 0)
       return;
+
+    reminder.phase = REMINDER_IDLE;
+
+    // Start the next queued alarm, oldest first
+    if (pendingCount > 0)
+    {
+      PendingDose next = pendingDoses[0];
+      pendingCount--;
+      for (uint8_t i = 0; i < pendingCount; i++)
+        pendingDoses[i] = pendingDoses[i + 1];
+      startReminder(next.hour, next.minute, reminder.dayIdx);
     }
-    delay(100);
+    return;
   }
 
-  // Timeout
-  digitalWrite(buzzer, LOW);
-  for (uint8_t i = 0; i < 7; i++)
-    digitalWrite(ledPins[i], LOW);
+  unsigned long elapsed = t - reminder.start;
 
-  display.clearDisplay();
-  display.setTextSize(2);
-  display.setCursor(10, 10);
-  display.println(F("MISSED"));
-  display.println(F("DOSE!"));
-  display.display();
-  delay(3000);
+  if (reminder.phase == REMINDER_URGENT && elapsed >= URGENT_PHASE_MS)
+  {
+    // 14 minute snooze - BUZZ_URGENT has already turned into BUZZ_SNOOZE
+    reminder.phase = REMINDER_SNOOZE;
+    saveCheckpoint();
+    LOG_INFO(LOG_ALARM, "STATUS: Snooze");
+  }
+
+  if (reminder.phase == REMINDER_SNOOZE && elapsed >= REMINDER_TIMEOUT_MS)
+  {
+    // Timeout
+    finishReminder(false);
+    return;
+  }
+
+  ledsShow(0, 1 << reminder.dayIdx); // Blink only today's LED
+
+  // The menu owns the screen while the user is editing
+  if (menu == NORMAL && !screenHeld())
+    showReminder(reminder.hour, reminder.minute);
 
-  Serial.println(F("STATUS: MISSED DOSE"));
+  if (btnPressed(BTN_CONFIRM))
+    finishReminder(true);
+}
+
+// ==================== ALARM CHECK ====================
+// One comparison per pass (see alarm_schedule.h). Alarms due at the same
+// minute all start a reminder - extra ones wait in the queue.
+void checkAlarms(ClockTime &now)
+{
+  PERF_SCOPE(PERF_ALARM);
+  uint16_t due = alarmIndex.poll(alarms, alarmCount, now.secondstime() / 60);
+  for (uint8_t i = 0; due && i < alarmCount; i++)
+  {
+    if (due & (1U << i))
+      startReminder(alarms[i].hour, alarms[i].minute, now.dayOfTheWeek());
+  }
 }
 
 void showMenu()
@@ -415,20 +1569,21 @@ void showMenu()
   {
     display.setCursor(0, 0);
     display.println(F("SELECT DOSE:"));
+    if (alarmCount == 0)
+      display.println(F("  (no alarms)"));
 
-    for (uint8_t i = 0; i < 3; i++)
+    // 4 rows fit - scroll so the selected alarm is always visible
+    uint8_t first = (selectedDose < 4) ? 0 : selectedDose - 3;
+    for (uint8_t i = first; i < alarmCount && i < first + 4; i++)
     {
       display.print(i == selectedDose ? F("> ") : F("  "));
-      if (i == 0)
-        display.print(F("MORNING "));
-      else if (i == 1)
-        display.print(F("AFTERNOON "));
-      else
-        display.print(F("EVENING "));
+      display.print((const __FlashStringHelper *)doseName(alarms[i].hour));
+      display.print(' ');
       printTime(alarms[i].hour, alarms[i].minute);
       display.println();
     }
-    display.println(F("\nUP/DOWN SET=Edit"));
+    display.setCursor(0, 48);
+    display.println(F("UP/DOWN SET=Edit"));
     display.println(F("HOME=Cancel"));
   }
   else if (menu == EDIT_HR)
@@ -465,29 +1620,34 @@ void showMenu()
     display.println(F("HOME=Cancel"));
   }
 
-  display.display();
+  display.flush();
+}
+
+void showCancelled()
+{
+  menu = NORMAL;
+  display.clearDisplay();
+  display.setTextSize(2);
+  display.setCursor(15, 20);
+  display.println(F("CANCELLED"));
+  display.flush();
+  holdScreen(1000);
 }
 
 void handleMenu()
 {
   // HOME button: Exit menu without saving (cancel operation)
-  if (btnPressed(homebtn))
+  if (btnPressed(BTN_HOME))
   {
-    menu = NORMAL;
-    display.clearDisplay();
-    display.setTextSize(2);
-    display.setCursor(15, 20);
-    display.println(F("CANCELLED"));
-    display.display();
-    delay(1000);
-    Serial.println(F("Menu cancelled - returned to home screen"));
+    showCancelled();
+    LOG_INFO(LOG_MENU, "Menu cancelled - returned to home screen");
     return;
   }
 
-  if (btnPressed(upbtn))
+  if (btnPressed(BTN_UP))
   {
-    if (menu == SELECT)
-      selectedDose = (selectedDose + 2) % 3;
+    if (menu == SELECT && alarmCount > 0)
+      selectedDose = (selectedDose + alarmCount - 1) % alarmCount;
     else if (menu == EDIT_HR)
       tempHour = (tempHour + 1) % 24;
     else if (menu == EDIT_MIN)
@@ -495,10 +1655,10 @@ void handleMenu()
     showMenu();
   }
 
-  if (btnPressed(downbtn))
+  if (btnPressed(BTN_DOWN))
   {
-    if (menu == SELECT)
-      selectedDose = (selectedDose + 1) % 3;
+    if (menu == SELECT && alarmCount > 0)
+      selectedDose = (selectedDose + 1) % alarmCount;
     else if (menu == EDIT_HR)
       tempHour = (tempHour + 23) % 24;
     else if (menu == EDIT_MIN)
@@ -506,13 +1666,14 @@ void handleMenu()
     showMenu();
   }
 
-  if (btnPressed(setbtn))
+  if (btnPressed(BTN_SET))
   {
-    if (menu == SELECT)
+    if (menu == SELECT && selectedDose < alarmCount) // A host may have deleted it
     {
       menu = EDIT_HR;
       tempHour = alarms[selectedDose].hour;
       tempMinute = alarms[selectedDose].minute;
+      editVersion = configVersion();
     }
     else if (menu == EDIT_HR)
     {
@@ -520,16 +1681,23 @@ void handleMenu()
     }
     else if (menu == EDIT_MIN)
     {
-      alarms[selectedDose].hour = tempHour;
-      alarms[selectedDose].minute = tempMinute;
-      saveAlarms();
+      // The schedule changed over serial while this was on screen: the
+      // index may now be another alarm, or gone. Don't save over that.
+      if (configVersion() != editVersion || !validAlarmIndex(selectedDose, false))
+      {
+        showCancelled();
+        LOG_INFO(LOG_MENU, "Alarms changed during the edit - not saved");
+        return;
+      }
+      setAlarm(selectedDose, tempHour, tempMinute);
       menu = NORMAL;
 
       display.clearDisplay();
       display.setCursor(20, 20);
       display.println(F("SAVED!"));
-      display.display();
-      delay(1000);
+      display.flush();
+      holdScreen(1000);
+      return;
     }
     showMenu();
   }
@@ -546,10 +1714,10 @@ void showPowerOff()
   display.setTextSize(1);
   display.setCursor(5, 58);
   display.println(F("Press POWER to turn ON"));
-  display.display();
+  display.flush();
 }
 
-void showNormal(DateTime &now)
+void showNormal(ClockTime &now)
 {
   display.clearDisplay();
   display.setTextSize(2);
@@ -574,41 +1742,114 @@ void showNormal(DateTime &now)
   display.println(days[now.dayOfTheWeek()]);
 
   display.setCursor(0, 40);
-  display.println(F("Alarms:"));
-  for (uint8_t i = 0; i < 3; i++)
+  if (alarmIndex.nextMask() == 0)
   {
-    if (alarms[i].enabled)
-    {
-      if (i == 0)
-        display.print('M');
-      else if (i == 1)
-        display.print('A');
-      else
-        display.print('E');
-      display.print(':');
-      printTime(alarms[i].hour, alarms[i].minute);
-      display.print(' ');
-    }
+    display.println(F("No alarms set"));
+  }
+  else
+  {
+    // Next dose, with its day if it isn't today
+    uint32_t next = alarmIndex.nextMinute();
+    display.print(F("Next dose: "));
+    if (next / 1440 != now.secondstime() / 86400UL)
+      display.print(days[dayOfWeekOf(next)]);
+    display.println();
+
+    uint8_t hour = (next % 1440) / 60;
+    uint8_t minute = next % 60;
+    display.print((const __FlashStringHelper *)doseName(hour));
+    display.print(' ');
+    printTime(hour, minute);
+  }
+
+  display.flush();
+}
+
+// ==================== SLEEP BETWEEN PASSES ====================
+// LEARNING NOTE: loop() used to run every 100 ms no matter what. Now each
+// pass ends by sleeping until there is something to do: a button, a serial
+// byte, the RTC's once-a-second tick, or (while a reminder or menu needs
+// beeps, blinks and timeouts) the next 100 ms step.
+
+#define PASS_BUSY_MS 100     // Reminder, menu or a held screen up
+#define PASS_IDLE_MS 1000    // Clock screen - normally the RTC tick comes first
+#define SERIAL_AWAKE_MS 2000 // No power-down this soon after serial traffic
+
+// Called at the start of each pass: count RTC seconds for GET_POWER
+void noteRtcTicks()
+{
+  uint8_t tick = rtcTickCount();
+  powerWindowTicks += (uint8_t)(tick - lastRtcTick);
+  lastRtcTick = tick;
+}
+
+// Something arrived that the next pass should handle. Serial bytes held
+// back for lack of output room (see handleSerialCommands()) wait for the
+// UART to make room instead - its interrupts wake us.
+bool wakeEventPending()
+{
+  bool serialReady = Serial.available() > 0 && serialOut.room() >= SEROUT_REPLY_ROOM;
+  return serialReady || buttonsPending() || rtcTickCount() != lastRtcTick;
+}
+
+void sleepUntilNextPass(unsigned long passStart)
+{
+  PERF_LOOP_END();
+
+#if LOW_POWER
+  bool busy = (reminder.phase != REMINDER_IDLE || menu != NORMAL || screenHoldActive ||
+               buzzerBusy());
+
+  // Switched off: power-down until a pin changes. millis() stands still
+  // meanwhile, which is fine - nothing is timed while the unit is off.
+  // (Except a new baud rate's probation, so stay in idle until it ends.)
+  if (!systemPowered && !busy && halMillis() - lastSerialActivity >= SERIAL_AWAKE_MS &&
+      !serialSpeed.onProbation() && !buttonsBusy() && Serial.available() == 0 &&
+      !wakeEventPending())
+  {
+    serialOut.drain(); // Power-down would cut off a byte still being sent
+    if (powerDown())
+      lastSerialActivity = halMillis(); // Stay up for the rest of the command
+    softClock.requestSync();            // millis() stood still while asleep
+    return;
   }
 
-  display.display();
+  // Otherwise idle sleep, which keeps millis(), the UART and PWM running.
+  // Short passes while the debouncer waits for a pin to settle.
+  unsigned long length = (busy || buttonsBusy()) ? PASS_BUSY_MS : PASS_IDLE_MS;
+  // Every byte the UART sends wakes us too - keep its buffer topped up.
+  while (halMillis() - passStart < length && !wakeEventPending())
+  {
+    serialOut.service();
+    powerIdle(passStart + length);
+  }
+#else
+  halDelay(PASS_BUSY_MS);
+#endif
 }
 
 // ==================== SETUP ====================
 void setup()
 {
-  Serial.begin(9600);
-  delay(500);
-  Serial.println(F("Smart Medication Reminder"));
+  loadSettings();
+  serialSpeed.begin(settings.baud); // Last rate a host confirmed
+  bootPause(500);
+  LOG_INFO(LOG_SYSTEM, "Smart Medication Reminder");
+  uint8_t resetFlags = halResetFlags();
+  if (resetFlags & HAL_RESET_WATCHDOG)
+    LOG_WARN(LOG_SYSTEM, "Restarted by the watchdog");
+  else if (resetFlags & HAL_RESET_BROWNOUT)
+    LOG_WARN(LOG_SYSTEM, "Restarted after a brown-out");
 
   // I2C
-  delay(500);
-  Wire.begin();
-  delay(500);
-  Serial.println(F("I2C OK"));
-
-  // OLED
-  display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  bootPause(500);
+  halI2cBegin();
+  LOG_INFO(LOG_SYSTEM, "I2C OK");
+
+  // OLED - answers on the bus once its controller is out of reset
+  if (!bootWaitFor(oledAddr, 500))
+    LOG_WARN(LOG_SYSTEM, "OLED not answering");
+  display.begin(SSD1306_SWITCHCAPVCC, oledAddr);
   display.clearDisplay();
   display.setTextColor(SSD1306_WHITE);
   display.setTextSize(1);
@@ -616,45 +1857,65 @@ void setup()
   display.println(F("Medication"));
   display.println(F("Reminder"));
   display.println(F("Starting..."));
-  display.display();
-  Serial.println(F("OLED OK"));
-  delay(2000);
+  display.flush();
+  LOG_INFO(LOG_SYSTEM, "OLED OK (picture uses %u bytes of RAM)", display.ramBytes());
+  bootPause(2000);
 
   // RTC
-  if (rtc.begin())
+  if (bootWaitFor(rtcAddr, 0) && halRtcBegin()) // Set to the build time if it was stopped
   {
-    Serial.println(F("RTC OK"));
-    if (!rtc.isrunning())
-    {
-      rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
-    }
+    LOG_INFO(LOG_SYSTEM, "RTC OK");
+    syncClock();
   }
-
-  // LEDs
-  for (uint8_t i = 0; i < 7; i++)
+  else
   {
-    pinMode(ledPins[i], OUTPUT);
-    digitalWrite(ledPins[i], LOW);
+    LOG_WARN(LOG_SYSTEM, "RTC not answering");
   }
 
+  // LEDs
+  ledsBegin(ledPins);
+
   // Buttons - Using INPUT mode (external 10kΩ pull-ups in diagram)
-  pinMode(upbtn, INPUT);
-  pinMode(downbtn, INPUT);
-  pinMode(setbtn, INPUT);
-  pinMode(confirmbtn, INPUT);
-  pinMode(homebtn, INPUT);      // A0 = BLACK button
-  pinMode(powerswitch, INPUT);  // A1 = SLIDE SWITCH
-  Serial.println(F("Buttons initialized (5 buttons + 1 switch)"));
+  // A0 = BLACK button, A1 = SLIDE SWITCH
+  buttonsBegin(buttonPins);
+  LOG_INFO(LOG_SYSTEM, "Buttons initialized (5 buttons + 1 switch)");
 
   // Buzzer
-  pinMode(buzzer, OUTPUT);
-  digitalWrite(buzzer, LOW);
+  buzzerBegin(buzzer);
+
+  // 1 Hz tick from the RTC, then sleep between loop() passes
+  halRtcSquareWave();
+  rtcTickBegin(rtcSqw);
+  powerBegin();
 
   // Load alarms
   loadAlarms();
+  eventLog.begin();
+  rescheduleAlarms();
+
+  // A reset while the switch is ON (watchdog, brown-out, or power back
+  // during a reminder) comes straight back up - with the reminder, if one
+  // was ringing. A normal power-up still waits for the switch.
+  bool switchOn = (buttonLevel(BTN_POWER) == HIGH);
+  bool resumed = resumeReminder(switchOn);
+  if (switchOn && (resumed || (resetFlags & (HAL_RESET_WATCHDOG | HAL_RESET_BROWNOUT))))
+  {
+    systemPowered = true;
+    lastSwitchState = HIGH;
+    events.push(PUSH_POWER, systemPowered);
+  }
 
-  Serial.println(F("Setup Complete!"));
-  Serial.println(F("System is OFF - Press POWER button to turn ON"));
+#if WATCHDOG
+  halWatchdogBegin(); // loop() kicks it on every pass
+#endif
+
+  LOG_INFO(LOG_SYSTEM, "Setup Complete!");
+  if (systemPowered)
+  {
+    LOG_INFO(LOG_SYSTEM, "=== SYSTEM POWERED ON (resumed) ===");
+    return; // loop() draws the clock or the reminder on its first pass
+  }
+  LOG_INFO(LOG_SYSTEM, "System is OFF - Press POWER button to turn ON");
 
   // Show power off screen initially
   showPowerOff();
@@ -663,109 +1924,121 @@ void setup()
 // ==================== MAIN LOOP ====================
 void loop()
 {
+  unsigned long passStart = halMillis();
+  PERF_LOOP_START();
+#if WATCHDOG
+  halWatchdogKick();
+#endif
+  noteRtcTicks();
+
   // Handle serial commands from website (ALWAYS check, even when powered off)
   handleSerialCommands();
 
-  // POWER SWITCH: Read current state (slide switch stays in position)
-  bool currentSwitchState = digitalRead(powerswitch);
+  // Collect button presses from the interrupt queue. A press ends a held
+  // screen and is handled right away.
+  pollButtons();
+  if (pressedButtons)
+    releaseScreen();
+
+  // POWER SWITCH: Debounced state (slide switch stays in position)
+  bool currentSwitchState = buttonLevel(BTN_POWER);
 
   // Detect change in switch position
   if (currentSwitchState != lastSwitchState)
   {
-    delay(50); // Debounce
-    currentSwitchState = digitalRead(powerswitch);
-
-    if (currentSwitchState != lastSwitchState)
-    {
-      lastSwitchState = currentSwitchState;
+    lastSwitchState = currentSwitchState;
 
-      Serial.print(F("Switch changed! State: "));
-      Serial.println(currentSwitchState == LOW ? F("LEFT (LOW)") : F("RIGHT (HIGH)"));
+    LOG_INFO(LOG_SYSTEM, "Switch changed! State: " LOG_PSTR,
+             currentSwitchState == LOW ? PSTR("LEFT (LOW)") : PSTR("RIGHT (HIGH)"));
 
-      // Switch position: RIGHT (HIGH) = ON, LEFT (LOW) = OFF
-      systemPowered = (currentSwitchState == HIGH);
+    // Switch position: RIGHT (HIGH) = ON, LEFT (LOW) = OFF
+    systemPowered = (currentSwitchState == HIGH);
+    events.push(PUSH_POWER, systemPowered);
 
-      if (systemPowered)
-      {
-        // System turning ON
-        Serial.println(F("=== SYSTEM POWERED ON ==="));
-        display.clearDisplay();
-        display.setTextSize(2);
-        display.setCursor(20, 20);
-        display.println(F("SYSTEM"));
-        display.println(F("   ON"));
-        display.display();
-        delay(1500);
-        menu = NORMAL;  // Reset to normal mode
-      }
-      else
-      {
-        // System turning OFF
-        Serial.println(F("=== SYSTEM POWERED OFF ==="));
-        menu = NORMAL;  // Exit any menu
-        // Turn off all LEDs
-        for (uint8_t i = 0; i < 7; i++)
-          digitalWrite(ledPins[i], LOW);
-        // Turn off buzzer
-        digitalWrite(buzzer, LOW);
-        // Show power off screen
-        showPowerOff();
-      }
+    if (systemPowered)
+    {
+      // System turning ON
+      LOG_INFO(LOG_SYSTEM, "=== SYSTEM POWERED ON ===");
+      display.clearDisplay();
+      display.setTextSize(2);
+      display.setCursor(20, 20);
+      display.println(F("SYSTEM"));
+      display.println(F("   ON"));
+      display.flush();
+      holdScreen(1500);
+      menu = NORMAL;  // Reset to normal mode
+    }
+    else
+    {
+      // System turning OFF
+      LOG_INFO(LOG_SYSTEM, "=== SYSTEM POWERED OFF ===");
+      menu = NORMAL;  // Exit any menu
+      releaseScreen();
+      cancelReminder();
+      // Turn off all LEDs
+      ledsShow(0);
+      // Turn off buzzer
+      buzzerStop();
+      buzzerTestRunning = false;
+      // Show power off screen
+      showPowerOff();
     }
   }
 
-  // If system is OFF, just wait (power off screen already shown)
+  // If system is OFF, just sleep (power off screen already shown)
   if (!systemPowered)
   {
-    delay(100);
+    sleepUntilNextPass(passStart);
     return;  // Skip rest of loop
   }
 
   // === SYSTEM IS ON - Normal operation ===
-  DateTime now = rtc.now();
+  ClockTime now = clockNow();
+
+  // While a reminder is active CONFIRM means "dose taken", not buzzer test
+  bool reminderActive = (reminder.phase != REMINDER_IDLE);
 
   // BUZZER TEST: Press CONFIRM button to test buzzer
-  if (menu == NORMAL && btnPressed(confirmbtn))
+  if (menu == NORMAL && !reminderActive && btnPressed(BTN_CONFIRM))
+  {
+    LOG_INFO(LOG_BUZZER, "*** BUZZER TEST ***");
+    LOG_DEBUG(LOG_BUZZER, "NOTE: VS Code Wokwi does NOT play buzzer audio! Watch the LEDs.");
+
+    // Timer2 plays the beeps; the passes below flash the LEDs along
+    buzzerPlay(BUZZ_TEST);
+    buzzerTestRunning = true;
+  }
+
+  // Flash all LEDs while the test beeps to show buzzer is active (they
+  // are written below, with the rest of this pass's LED state)
+  bool testLeds = buzzerTestRunning; // The test decides the LEDs this pass
+  bool testFlash = false;
+  if (buzzerTestRunning)
   {
-    Serial.println(F("*** BUZZER TEST ***"));
-    Serial.println(F("NOTE: VS Code Wokwi does NOT play buzzer audio!"));
-    Serial.println(F("But the buzzer IS working - watch the LED flash!"));
+    bool testing = (buzzerPattern() == BUZZ_TEST);
+    testFlash = testing && buzzerOn();
 
-    for (int i = 0; i < 3; i++)
+    if (!testing)
     {
-      digitalWrite(buzzer, HIGH);
-      // Flash all LEDs to show buzzer is active
-      for (uint8_t j = 0; j < 7; j++)
-        digitalWrite(ledPins[j], HIGH);
-
-      Serial.print(F("BEEP "));
-      Serial.print(i + 1);
-      Serial.println(F(" - Buzzer HIGH"));
-      delay(300);
-
-      digitalWrite(buzzer, LOW);
-      for (uint8_t j = 0; j < 7; j++)
-        digitalWrite(ledPins[j], LOW);
-
-      Serial.println(F("  - Buzzer LOW"));
-      delay(300);
+      buzzerTestRunning = false;
+      LOG_INFO(LOG_BUZZER, "*** Buzzer test complete! ***");
     }
-    Serial.println(F("*** Buzzer test complete! Buzzer IS working! ***"));
   }
 
   // HOME button in normal mode: Refresh display / Wake screen
-  if (menu == NORMAL && btnPressed(homebtn))
+  if (menu == NORMAL && !reminderActive && btnPressed(BTN_HOME))
   {
     display.clearDisplay();
     display.setTextSize(2);
     display.setCursor(20, 20);
     display.println(F("REFRESH"));
-    display.display();
-    delay(500);
-    Serial.println(F("Display refreshed"));
+    display.invalidate(); // Resend the whole frame in case the panel glitched
+    display.flush();
+    holdScreen(500);
+    LOG_DEBUG(LOG_SYSTEM, "Display refreshed");
   }
 
-  if (menu == NORMAL && btnPressed(setbtn))
+  if (menu == NORMAL && btnPressed(BTN_SET))
   {
     menu = SELECT;
     selectedDose = 0;
@@ -776,36 +2049,36 @@ void loop()
   {
     handleMenu();
   }
-  else
+  else if (!reminderActive)
   {
-    showNormal(now);
+    if (!screenHeld())
+      showNormal(now);
+  }
 
+  // LEDs: one ledsShow() per pass, which only reaches the pins when the
+  // mask changes. A ringing reminder blinks its own (serviceReminder()).
+  if (menu == NORMAL && !reminderActive && !buzzerTestRunning)
+  {
     // Light current day LED
-    for (uint8_t i = 0; i < 7; i++)
-      digitalWrite(ledPins[i], LOW);
-
     // CORRECT LED Mapping:
     // RTC: 0=Sun, 1=Mon, 2=Tue, 3=Wed, 4=Thu, 5=Fri, 6=Sat
     // LED: Pin2=RED(Sun), Pin3=GREEN(Mon), Pin4=BLUE(Tue), Pin5=YELLOW(Wed), Pin6=ORANGE(Thu), Pin7=PURPLE(Fri), Pin8=CYAN(Sat)
     uint8_t rtcDay = now.dayOfTheWeek();
     uint8_t dayIdx = rtcDay;  // Direct mapping - no reversal needed
 
-    digitalWrite(ledPins[dayIdx], HIGH);
-
-    Serial.print(F("RTC Day: "));
-    Serial.print(rtcDay);
-    Serial.print(F(" → LED Index: "));
-    Serial.print(dayIdx);
-    Serial.print(F(" → Pin "));
-    Serial.println(ledPins[dayIdx]);
+    ledsShow(1 << dayIdx);
 
-    // Check alarms
-    uint8_t alarmIdx;
-    if (checkAlarm(now, alarmIdx))
-    {
-      triggerAlarm(alarmIdx);
-    }
+    LOG_DEBUG(LOG_LED, "RTC Day: %u → LED Index: %u → Pin %u", rtcDay, dayIdx, ledPins[dayIdx]);
   }
+  else if (testLeds)
+  {
+    ledsShow(testFlash ? LED_ALL : 0); // All off once the test is over
+  }
+
+  // Check alarms (a late pass still fires - see alarm_schedule.h)
+  checkAlarms(now);
+
+  serviceReminder();
 
-  delay(100);
+  sleepUntilNextPass(passStart);
 }
@@ -0,0 +1,131 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// ==================== HOST STAND-IN FOR THE ARDUINO CORE ====================
+// Just enough of <Arduino.h> for the firmware sources to build on Linux
+// ([env:native]). Flash (PROGMEM) is ordinary memory here, and Serial is
+// stdin/stdout. There is deliberately no millis(), digitalRead() etc. -
+// firmware code goes through hal.h for those.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+// ---- Flash strings ----
+#define PROGMEM
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+#define vsnprintf_P vsnprintf
+#define snprintf_P snprintf
+
+// ---- Pins (Uno numbering) ----
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define NUM_PINS 20
+
+#define bit(b) (1UL << (b))
+
+// ---- Print / Stream ----
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual int availableForWrite() { return 0; }
+
+  size_t write(const uint8_t *buf, size_t len);
+  size_t print(const char *s);
+  size_t print(const __FlashStringHelper *s);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = 10) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = 10) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = 10) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = 10);
+  size_t print(unsigned long n, int base = 10);
+  size_t println();
+  template <typename T>
+  size_t println(T v)
+  {
+    size_t n = print(v);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(T v, int base)
+  {
+    size_t n = print(v, base);
+    return n + println();
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+};
+
+// ---- Serial: stdin/stdout, fed by the simulator ----
+// With `wire` set, bytes take 10 bit times each way on the virtual clock:
+// sent bytes wait in a 64-byte TX buffer (write() blocks while it's full,
+// like the real one) and received bytes trickle in. A byte sent at a rate
+// the other end isn't using arrives as garbage.
+#define HOST_SERIAL_TX_BUFFER 64
+
+class HostSerial : public Stream
+{
+public:
+  HostSerial()
+      : baud(9600), hostBaud(9600), wire(false), echo(true), lineDoneUs(0),
+        onReplyLine(NULL), onLine(NULL), txDoneUs(0) {}
+  void begin(unsigned long baud) { this->baud = baud; }
+  void end() {}
+  size_t write(uint8_t c);
+  using Print::write;
+  int availableForWrite(); // Never busy without `wire`
+  int available();
+  int read();
+  void flush(); // Waits until the TX buffer is sent
+
+  // Simulator side: queue bytes as if the host had sent them, starting
+  // no earlier than atUs
+  void inject(const char *s, size_t len, uint64_t atUs = 0);
+  // Virtual time the next byte still on the wire arrives (UINT64_MAX: none)
+  uint64_t nextRxUs();
+  // Virtual time the next sent byte leaves the TX buffer - the UART
+  // interrupt that wakes an idle CPU (UINT64_MAX: nothing being sent)
+  uint64_t nextTxUs();
+
+  unsigned long baud;     // Device side (Serial.begin)
+  unsigned long hostBaud; // Host side, for the wire model
+  bool wire;
+  bool echo;                 // Copy what the firmware sends to stdout
+  uint64_t lineDoneUs;       // When the last line's '\n' got to the host
+  void (*onReplyLine)();     // After each line that isn't a log line ('#')
+  void (*onLine)(const char *line); // After every line, without the CR LF
+
+private:
+  uint64_t txDoneUs; // The TX buffer is empty from then on
+};
+
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,183 @@
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include "hal_native.h"
+
+// ---- Print ----
+size_t Print::write(const uint8_t *buf, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+    write(buf[i]);
+  return len;
+}
+
+size_t Print::print(const char *s)
+{
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t Print::print(const __FlashStringHelper *s)
+{
+  return print(reinterpret_cast<const char *>(s));
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(long n, int base)
+{
+  if (n < 0 && base == 10)
+    return print('-') + print((unsigned long)-n, base);
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  char buf[8 * sizeof(long) + 1];
+  char *p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  do
+  {
+    uint8_t d = n % base;
+    *--p = d < 10 ? '0' + d : 'A' + d - 10;
+    n /= base;
+  } while (n);
+  return print(p);
+}
+
+size_t Print::println()
+{
+  return print("\r\n");
+}
+
+// ---- Serial ----
+HostSerial Serial;
+
+static std::string rxQueue;
+static std::vector<uint64_t> rxAt;        // Arrival time of each byte
+static std::vector<unsigned long> rxBaud; // Rate it was sent at (0: any)
+static size_t rxPos = 0;
+static bool lineStart = true;
+static bool logLine = false;
+static std::string lineText; // The line being sent, for onLine
+
+// One start bit, 8 data bits, one stop bit
+static uint64_t byteUs(unsigned long baud)
+{
+  return 10000000ULL / baud;
+}
+
+size_t HostSerial::write(uint8_t c)
+{
+  lineDoneUs = simMicros();
+  if (wire)
+  {
+    // Full buffer: wait for a byte to go out
+    uint64_t bu = byteUs(baud);
+    uint64_t now = simMicros();
+    if (txDoneUs < now)
+      txDoneUs = now;
+    if (txDoneUs - now > (HOST_SERIAL_TX_BUFFER - 1) * bu)
+      simAdvance(txDoneUs - now - (HOST_SERIAL_TX_BUFFER - 1) * bu);
+    txDoneUs += bu;
+    lineDoneUs = txDoneUs;
+    if (baud != hostBaud)
+      c = '?';
+  }
+  if (echo)
+    putchar(c);
+  if (lineStart)
+    logLine = (c == '#');
+  lineStart = (c == '\n');
+  if (lineStart && !logLine && onReplyLine)
+    onReplyLine();
+
+  if (onLine)
+  {
+    if (c == '\n')
+    {
+      onLine(lineText.c_str());
+      lineText.clear();
+    }
+    else if (c != '\r')
+    {
+      lineText += (char)c;
+    }
+  }
+  return 1;
+}
+
+int HostSerial::availableForWrite()
+{
+  if (!wire)
+    return 0x7FFF;
+  uint64_t bu = byteUs(baud);
+  uint64_t now = simMicros();
+  uint64_t inFlight = txDoneUs > now ? (txDoneUs - now + bu - 1) / bu : 0;
+  int room = HOST_SERIAL_TX_BUFFER - (int)inFlight;
+  if (room > HOST_SERIAL_TX_BUFFER - 1)
+    room = HOST_SERIAL_TX_BUFFER - 1; // One slot always stays empty
+  return room > 0 ? room : 0;
+}
+
+void HostSerial::flush()
+{
+  fflush(stdout);
+  if (wire && txDoneUs > simMicros())
+    simAdvance(txDoneUs - simMicros());
+}
+
+uint64_t HostSerial::nextTxUs()
+{
+  uint64_t now = simMicros();
+  if (!wire || txDoneUs <= now)
+    return UINT64_MAX;
+  uint64_t bu = byteUs(baud);
+  return txDoneUs - (txDoneUs - now - 1) / bu * bu;
+}
+
+int HostSerial::available()
+{
+  size_t n = rxPos;
+  while (n < rxQueue.size() && rxAt[n] <= simMicros())
+    n++;
+  return (int)(n - rxPos);
+}
+
+int HostSerial::read()
+{
+  if (available() == 0)
+    return -1;
+  uint8_t c = (uint8_t)rxQueue[rxPos];
+  unsigned long sentAt = rxBaud[rxPos++];
+  return (sentAt == 0 || sentAt == baud) ? c : 0xF0; // Framing garbage at the wrong rate
+}
+
+uint64_t HostSerial::nextRxUs()
+{
+  return rxPos < rxQueue.size() ? rxAt[rxPos] : UINT64_MAX;
+}
+
+void HostSerial::inject(const char *s, size_t len, uint64_t atUs)
+{
+  rxQueue.erase(0, rxPos);
+  rxAt.erase(rxAt.begin(), rxAt.begin() + rxPos);
+  rxBaud.erase(rxBaud.begin(), rxBaud.begin() + rxPos);
+  rxPos = 0;
+
+  uint64_t t = simMicros();
+  if (atUs > t)
+    t = atUs;
+  if (!rxAt.empty() && rxAt.back() > t)
+    t = rxAt.back();
+  for (size_t i = 0; i < len; i++)
+  {
+    if (wire)
+      t += byteUs(hostBaud);
+    rxQueue.push_back(s[i]);
+    rxAt.push_back(t);
+    rxBaud.push_back(wire ? hostBaud : 0); // 0: whatever rate is set
+  }
+}
@@ -0,0 +1,87 @@
+#include "display_sink.h"
+#include "hal.h"
+#include "hal_native.h"
+
+DisplaySink::DisplaySink(uint8_t w, uint8_t h)
+    : sentPerSec(0), fullPerSec(0), renderUs(0), frames(0), shownUs(0), dumpTo(NULL),
+      onFrame(NULL), cursorX(0), cursorY(0), textSize(1), forceFrame(true), busUntil(0)
+{
+  clearDisplay();
+  memcpy(shown, grid, sizeof(shown));
+}
+
+void DisplaySink::clearDisplay()
+{
+  for (uint8_t r = 0; r < SINK_ROWS; r++)
+  {
+    memset(grid[r], ' ', SINK_COLS);
+    grid[r][SINK_COLS] = '\0';
+  }
+  cursorX = cursorY = 0;
+}
+
+void DisplaySink::setCursor(int16_t x, int16_t y)
+{
+  cursorX = x;
+  cursorY = y;
+}
+
+size_t DisplaySink::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursorX = 0;
+    cursorY += 8 * textSize;
+    return 1;
+  }
+  if (c == '\r')
+    return 1;
+  if (cursorX + 6 * textSize > 128) // Wraps like Adafruit_GFX does
+  {
+    cursorX = 0;
+    cursorY += 8 * textSize;
+  }
+
+  int16_t col = cursorX / 6;
+  int16_t row = cursorY / 8;
+  if (col >= 0 && col < SINK_COLS && row >= 0 && row < SINK_ROWS)
+    grid[row][col] = (char)c;
+  cursorX += 6 * textSize;
+  return 1;
+}
+
+void DisplaySink::flush()
+{
+  if (!forceFrame && memcmp(grid, shown, sizeof(grid)) == 0)
+    return;
+
+  // The rows that changed go out behind whatever is still on the bus
+  uint8_t rows = 0;
+  for (uint8_t r = 0; r < SINK_ROWS; r++)
+  {
+    if (forceFrame || memcmp(grid[r], shown[r], SINK_COLS) != 0)
+      rows++;
+  }
+  uint64_t now = simMicros();
+  busUntil = (busUntil > now ? busUntil : now) + rows * SINK_ROW_US;
+  shownUs = busUntil;
+
+  // Wait until only the last rows are in flight
+  uint64_t queued = SINK_ROWS_IN_FLIGHT * SINK_ROW_US;
+  if (busUntil > now + queued)
+    simAdvance(busUntil - queued - now);
+
+  forceFrame = false;
+  memcpy(shown, grid, sizeof(shown));
+  frames++;
+
+  if (dumpTo)
+  {
+    unsigned long s = halMillis() / 1000;
+    fprintf(dumpTo, "+%lu:%02lu:%02lu\n", s / 3600, s / 60 % 60, s % 60);
+    for (uint8_t r = 0; r < SINK_ROWS; r++)
+      fprintf(dumpTo, "|%s|\n", shown[r]);
+  }
+  if (onFrame)
+    onFrame();
+}
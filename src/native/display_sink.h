@@ -0,0 +1,63 @@
+#ifndef DISPLAY_SINK_H
+#define DISPLAY_SINK_H
+
+#include <Arduino.h>
+
+// ==================== HOST DISPLAY SINK ====================
+// Stands in for the SSD1306 in the native build. It takes the same text
+// calls the screens make and keeps a grid of 6x8 character cells, so the
+// simulator can print what the panel would show.
+
+#define SSD1306_SWITCHCAPVCC 0x02
+#define SSD1306_WHITE 1
+
+#define SINK_COLS (128 / 6)
+#define SINK_ROWS (64 / 8)
+
+// Each changed row (one SSD1306 page) keeps the bus busy as long as its
+// transaction would at 400 kHz: address, 13 command bytes and 128 data
+// bytes, 9 bits each (see oled.cpp). flush() only queues the rows - it
+// waits while more than SINK_ROWS_IN_FLIGHT are still going out, like
+// Oled waits for its page buffers.
+#define SINK_ROW_US ((1 + 13 + 128) * 9 * 1000000UL / 400000UL)
+#define SINK_ROWS_IN_FLIGHT 2
+
+class DisplaySink : public Print
+{
+public:
+  DisplaySink(uint8_t w, uint8_t h);
+
+  bool begin(uint8_t vcc, uint8_t addr) { return true; }
+  void clearDisplay();
+  void setTextSize(uint8_t size) { textSize = size ? size : 1; }
+  void setTextColor(uint16_t color) {}
+  void setCursor(int16_t x, int16_t y);
+  size_t write(uint8_t c);
+  using Print::write;
+
+  // Same calls as Oled. flush() counts frames that changed.
+  void flush();
+  void invalidate() { forceFrame = true; }
+  uint16_t ramBytes() const { return sizeof(grid) + sizeof(shown); }
+  uint32_t sentPerSec;
+  uint32_t fullPerSec;
+  uint32_t renderUs;
+
+  // ---- Simulator side ----
+  const char *row(uint8_t r) const { return shown[r]; }
+  uint32_t frames;          // flush() calls that changed the screen
+  uint64_t shownUs;         // simMicros() the last frame is fully on the panel
+  FILE *dumpTo;             // If set, every changed frame is printed here
+  void (*onFrame)();        // After every changed frame
+
+private:
+  char grid[SINK_ROWS][SINK_COLS + 1];  // Being drawn
+  char shown[SINK_ROWS][SINK_COLS + 1]; // As of the last flush()
+  int16_t cursorX;
+  int16_t cursorY;
+  uint8_t textSize;
+  bool forceFrame;
+  uint64_t busUntil; // simMicros() the queued rows are all sent
+};
+
+#endif
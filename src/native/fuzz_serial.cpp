@@ -0,0 +1,279 @@
+#include <Arduino.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dirent.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "hal_native.h"
+#include "binary_link.h"
+#include "command_reader.h"
+#include "event_stream.h"
+#include "serial_out.h"
+
+// ==================== SERIAL COMMAND FUZZER ====================
+// Feeds arbitrary bytes to handleSerialCommands() on the virtual board -
+// the same text and binary parsers, command handlers and EEPROM code as
+// the firmware, with Serial and the EEPROM from hal_native.cpp. Every
+// input starts from the same state: a fresh EEPROM image, setup(), text
+// mode, no subscription or batch.
+//
+// libFuzzer (clang):
+//   clang++ -std=gnu++11 -g -O1 -fsanitize=fuzzer,address,undefined -D FUZZ_LIBFUZZER
+//     -I src/native -I include <firmware + native sources> -o fuzz_serial
+//   ./fuzz_serial -max_total_time=300 src/native/corpus
+//
+// Without libFuzzer ([env:fuzz], gcc + sanitizers):
+//   fuzz_serial [--mutate N] [--seed S] FILE|DIR...
+//                   Run every file once, then N random mutations of them
+//                   (FUZZ_ECHO=1 in the environment shows the replies)
+//   fuzz_serial --bench N FILE|DIR...
+//                   Run each input N times, timing every command on its
+//                   own, and report commands/s and the worst single
+//                   command (host time - on the board, GET_PERF's serial
+//                   max is the number to watch)
+
+void setup();
+void handleSerialCommands();
+void cmdBatchAbort(uint8_t argc, char **argv);
+extern BinaryLink binaryLink;
+extern CommandReader serialReader;
+extern EventStream events;
+
+// Most passes one input may take: each pass reads at most 64 bytes, and
+// a pass that reads nothing (output backpressure) still sends some
+#define FUZZ_MAX_PASSES 4096
+
+static uint8_t cleanEeprom[HAL_EEPROM_SIZE];
+static bool booted = false;
+
+static void boot()
+{
+  Serial.echo = getenv("FUZZ_ECHO") != NULL; // Show the replies
+  simSetRtc(9137UL * 86400UL + 7 * 3600UL + 55 * 60UL); // 2025-01-06 07:55, like sim_main
+  setup();
+  memcpy(cleanEeprom, simEeprom(), sizeof(cleanEeprom));
+  booted = true;
+}
+
+static void resetBoard()
+{
+  if (!booted)
+    boot();
+  memcpy(simEeprom(), cleanEeprom, sizeof(cleanEeprom));
+  setup();
+  // RAM that setup() leaves alone (zero after a real reset)
+  binaryLink.end();
+  serialReader.reset();
+  events.subscribe(false);
+  cmdBatchAbort(0, NULL);
+  serialOut.drain();
+}
+
+// Hand the bytes to the firmware and let it read all of them
+static void runInput(const uint8_t *data, size_t size)
+{
+  Serial.inject((const char *)data, size);
+  for (int i = 0; i < FUZZ_MAX_PASSES && Serial.available() > 0; i++)
+    handleSerialCommands();
+  while (Serial.available() > 0)
+    Serial.read(); // Don't leak into the next input
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  resetBoard();
+  runInput(data, size);
+  return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+// ---- Standalone driver ----
+struct FuzzInput
+{
+  std::string name;
+  std::string data;
+};
+
+static void loadFile(const std::string &path, std::vector<FuzzInput> &inputs)
+{
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return;
+  FuzzInput in;
+  in.name = path;
+  char buf[512];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    in.data.append(buf, n);
+  fclose(f);
+  inputs.push_back(in);
+}
+
+static void loadPath(const char *path, std::vector<FuzzInput> &inputs)
+{
+  DIR *dir = opendir(path);
+  if (!dir)
+  {
+    loadFile(path, inputs);
+    return;
+  }
+  std::vector<std::string> names;
+  while (struct dirent *e = readdir(dir))
+  {
+    if (e->d_name[0] != '.')
+      names.push_back(e->d_name);
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  for (size_t i = 0; i < names.size(); i++)
+    loadFile(std::string(path) + "/" + names[i], inputs);
+}
+
+// Flip, insert, delete or splice a few bytes
+static std::string mutate(const std::vector<FuzzInput> &inputs)
+{
+  static const char interesting[] = ":\n\r\0\xff" "0123456789";
+  std::string s = inputs[rand() % inputs.size()].data;
+  int edits = 1 + rand() % 4;
+  for (int e = 0; e < edits; e++)
+  {
+    size_t at = s.empty() ? 0 : rand() % (s.size() + 1);
+    switch (rand() % 5)
+    {
+    case 0:
+      if (at < s.size())
+        s[at] ^= (char)(1 << (rand() % 8));
+      break;
+    case 1:
+      s.insert(at, 1, interesting[rand() % (sizeof(interesting) - 1)]);
+      break;
+    case 2:
+      if (at < s.size())
+        s.erase(at, 1 + rand() % 8);
+      break;
+    case 3:
+    {
+      const std::string &other = inputs[rand() % inputs.size()].data;
+      if (!other.empty())
+      {
+        size_t from = rand() % other.size();
+        s.insert(at, other, from, 1 + rand() % (other.size() - from));
+      }
+      break;
+    }
+    default:
+      s.insert(at, std::string(1 + rand() % 80, (char)('A' + rand() % 26)));
+      break;
+    }
+  }
+  return s;
+}
+
+static double nowNs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Length of the command at the front of data: up to the end of its
+// line, or of its frame once BINARY has switched the link over
+static size_t nextCommand(const std::string &data, size_t from)
+{
+  char end = binaryLink.active() ? '\0' : '\n';
+  size_t i = from;
+  while (i < data.size() && data[i] != end && data[i] != '\0')
+    i++;
+  return (i < data.size() ? i + 1 : i) - from;
+}
+
+static void runBench(const std::vector<FuzzInput> &inputs, unsigned long rounds)
+{
+  double totalNs = 0;
+  double worstNs = 0;
+  std::string worstName;
+  unsigned long commands = 0;
+
+  printf("%-40s %12s %12s\n", "input", "mean us/cmd", "worst cmd us");
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    const FuzzInput &in = inputs[i];
+    const uint8_t *data = (const uint8_t *)in.data.data();
+    double sum = 0;
+    double max = 0;
+    unsigned long count = 0;
+    for (unsigned long r = 0; r < rounds; r++)
+    {
+      resetBoard(); // Outside the timed part
+      for (size_t pos = 0; pos < in.data.size();)
+      {
+        size_t len = nextCommand(in.data, pos);
+        double begin = nowNs();
+        runInput(data + pos, len);
+        double ns = nowNs() - begin;
+        pos += len;
+        sum += ns;
+        count++;
+        if (ns > max)
+          max = ns;
+      }
+    }
+    printf("%-40s %12.2f %12.2f\n", in.name.c_str(), count ? sum / count / 1000 : 0.0, max / 1000);
+    totalNs += sum;
+    commands += count;
+    if (max > worstNs)
+    {
+      worstNs = max;
+      worstName = in.name;
+    }
+  }
+  // Host times, not AVR cycles: on the board, GET_PERF's serial max is
+  // the figure for one command
+  printf("# %lu commands in %.1f ms: %.0f commands/s, worst single command %.2f us host time (%s)\n",
+         commands, totalNs / 1e6, commands / (totalNs / 1e9), worstNs / 1000, worstName.c_str());
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long mutations = 0;
+  unsigned long benchRounds = 0;
+  unsigned seed = 1;
+  std::vector<FuzzInput> inputs;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--mutate") && i + 1 < argc)
+      mutations = strtoul(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      seed = strtoul(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--bench") && i + 1 < argc)
+      benchRounds = strtoul(argv[++i], NULL, 10);
+    else
+      loadPath(argv[i], inputs);
+  }
+  if (inputs.empty())
+  {
+    fprintf(stderr, "usage: %s [--mutate N] [--seed S] [--bench N] FILE|DIR...\n", argv[0]);
+    return 2;
+  }
+
+  if (benchRounds > 0)
+  {
+    runBench(inputs, benchRounds);
+    return 0;
+  }
+
+  for (size_t i = 0; i < inputs.size(); i++)
+    LLVMFuzzerTestOneInput((const uint8_t *)inputs[i].data.data(), inputs[i].data.size());
+
+  srand(seed);
+  for (unsigned long m = 0; m < mutations; m++)
+  {
+    std::string s = mutate(inputs);
+    LLVMFuzzerTestOneInput((const uint8_t *)s.data(), s.size());
+  }
+  printf("# %zu inputs and %lu mutations ran clean\n", inputs.size(), mutations);
+  return 0;
+}
+#endif
@@ -0,0 +1,238 @@
+#include "hal.h"
+#include "hal_native.h"
+
+// Host side of hal.h - a virtual board for the native build
+
+static uint64_t nowUs = 0;
+static uint64_t wakeAt = UINT64_MAX;
+static uint64_t busyUs = 0;
+static void (*wakeHook)() = NULL;
+static uint32_t rtcStart = 0;
+static bool rtcRunning = false;
+static bool sqwOn = false;
+static uint8_t resetFlags = HAL_RESET_POWER_ON;
+
+static uint8_t pinLevel[NUM_PINS];
+static uint8_t pinOutput[NUM_PINS];
+static uint8_t eeprom[HAL_EEPROM_SIZE];
+
+// ---- Simulator controls ----
+uint64_t simMicros()
+{
+  return nowUs;
+}
+
+void simSetRtc(uint32_t seconds)
+{
+  rtcStart = seconds - (uint32_t)(nowUs / 1000000ULL);
+  rtcRunning = true;
+}
+
+void simSetPin(uint8_t pin, uint8_t level)
+{
+  if (pin < NUM_PINS)
+    pinLevel[pin] = level;
+}
+
+uint8_t simPinOutput(uint8_t pin)
+{
+  return pin < NUM_PINS ? pinOutput[pin] : LOW;
+}
+
+void simSetResetFlags(uint8_t flags)
+{
+  resetFlags = flags;
+}
+
+void simSetWakeAt(uint64_t us)
+{
+  wakeAt = us;
+}
+
+void simOnWake(void (*hook)())
+{
+  wakeHook = hook;
+}
+
+// Let the simulator act if the clock just reached the wake time
+static void reachedWake()
+{
+  if (wakeHook && nowUs >= wakeAt)
+    wakeHook();
+}
+
+void simAdvance(uint64_t us)
+{
+  nowUs += us;
+  busyUs += us;
+}
+
+uint64_t simBusyUs()
+{
+  return busyUs;
+}
+
+uint8_t *simEeprom()
+{
+  return eeprom;
+}
+
+// Unset pins read HIGH (the buttons have pull-ups), a blank EEPROM is 0xFF
+static struct BoardInit
+{
+  BoardInit()
+  {
+    memset(pinLevel, HIGH, sizeof(pinLevel));
+    memset(eeprom, 0xFF, sizeof(eeprom));
+  }
+} boardInit;
+
+// ---- Time ----
+unsigned long halMillis()
+{
+  return (unsigned long)(uint32_t)(nowUs / 1000);
+}
+
+unsigned long halMicros()
+{
+  return (unsigned long)(uint32_t)nowUs; // Wraps like the real micros()
+}
+
+void halDelay(unsigned long ms)
+{
+  uint64_t end = nowUs + (uint64_t)ms * 1000;
+  busyUs += (uint64_t)ms * 1000;
+  while (wakeHook && wakeAt >= nowUs && wakeAt <= end)
+  {
+    uint64_t at = wakeAt;
+    nowUs = at;
+    wakeHook();
+    if (wakeAt <= at)
+      break;
+  }
+  nowUs = end;
+}
+
+// ---- GPIO ----
+void halPinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void halDigitalWrite(uint8_t pin, uint8_t level)
+{
+  if (pin < NUM_PINS)
+    pinOutput[pin] = level;
+}
+
+// DS1307 SQW at 1 Hz: falls as the seconds advance, rises half way
+static uint8_t sqwLevel()
+{
+  return (nowUs % 1000000ULL) < 500000ULL ? LOW : HIGH;
+}
+
+uint8_t halDigitalRead(uint8_t pin)
+{
+  if (sqwOn && pin == SIM_SQW_PIN)
+    return sqwLevel();
+  return pin < NUM_PINS ? pinLevel[pin] : LOW;
+}
+
+// ---- Sleep ----
+static uint64_t nextSqwEdge()
+{
+  if (!sqwOn)
+    return UINT64_MAX;
+  return (nowUs / 500000ULL + 1) * 500000ULL;
+}
+
+void halSleepIdle(unsigned long untilMs)
+{
+  uint64_t target = UINT64_MAX;
+  unsigned long ahead = untilMs - halMillis();
+  if (ahead < 0x80000000UL)
+    target = nowUs - nowUs % 1000 + (uint64_t)ahead * 1000;
+  if (nextSqwEdge() < target)
+    target = nextSqwEdge();
+  if (wakeAt < target)
+    target = wakeAt;
+  if (Serial.nextRxUs() < target)
+    target = Serial.nextRxUs(); // RX complete interrupt
+  if (Serial.nextTxUs() < target)
+    target = Serial.nextTxUs(); // TX buffer has room again
+
+  // At the latest, the millis() interrupt wakes us a millisecond later
+  if (target <= nowUs)
+    target = nowUs - nowUs % 1000 + 1000;
+  nowUs = target;
+  reachedWake();
+}
+
+bool halSleepPowerDown()
+{
+  uint64_t target = nextSqwEdge();
+  if (wakeAt < target)
+    target = wakeAt;
+  if (Serial.nextRxUs() < target)
+    target = Serial.nextRxUs(); // Start bit on RX (PCINT16)
+  if (target != UINT64_MAX && target > nowUs)
+    nowUs = target;
+  reachedWake();
+  return Serial.available() > 0;
+}
+
+// ---- I2C bus + RTC ----
+void halI2cBegin()
+{
+}
+
+bool halI2cProbe(uint8_t addr)
+{
+  return true; // The OLED and the RTC are always there
+}
+
+bool halRtcBegin()
+{
+  rtcRunning = true;
+  return true;
+}
+
+bool halRtcRead(uint32_t &t)
+{
+  if (!rtcRunning)
+    return false;
+  t = rtcStart + (uint32_t)(nowUs / 1000000ULL);
+  return true;
+}
+
+void halRtcSquareWave()
+{
+  sqwOn = true;
+}
+
+// ---- Reset cause + watchdog ----
+uint8_t halResetFlags()
+{
+  return resetFlags;
+}
+
+// Nothing hangs on the virtual clock - a pass that never ends never
+// returns to the simulator either
+void halWatchdogBegin()
+{
+}
+
+void halWatchdogKick()
+{
+}
+
+// ---- EEPROM ----
+uint8_t halEepromRead(uint16_t addr)
+{
+  return addr < HAL_EEPROM_SIZE ? eeprom[addr] : 0xFF;
+}
+
+void halEepromUpdate(uint16_t addr, uint8_t value)
+{
+  if (addr < HAL_EEPROM_SIZE)
+    eeprom[addr] = value;
+}
@@ -0,0 +1,47 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <Arduino.h>
+
+// ==================== HOST HAL: SIMULATOR CONTROLS ====================
+// The native hal.h implementation runs on a virtual clock that only moves
+// when the firmware delays or sleeps. Sleeping jumps straight to the next
+// thing that would wake the board: an RTC SQW edge, the deadline the
+// firmware asked for, or the next event the simulator scheduled.
+
+#define SIM_SQW_PIN A2 // Where the RTC's SQW/OUT is wired (diagram.json)
+
+// Virtual time since the simulation started
+uint64_t simMicros();
+
+// RTC time at virtual time 0, in seconds since 2000-01-01
+void simSetRtc(uint32_t seconds);
+
+// Drive an input pin (buttons are active LOW, the power switch HIGH = ON)
+void simSetPin(uint8_t pin, uint8_t level);
+// What the firmware last wrote to an output pin
+uint8_t simPinOutput(uint8_t pin);
+
+// What halResetFlags() reports (HAL_RESET_xxx, default power-on)
+void simSetResetFlags(uint8_t flags);
+
+// Sleeps don't go past this virtual time (the next simulator event)
+void simSetWakeAt(uint64_t us);
+
+// Called when the clock reaches the wake time - in a sleep or in the
+// middle of halDelay() - so the simulator can change inputs right then,
+// the way a pin-change interrupt would catch them. The hook should move
+// the wake time on.
+void simOnWake(void (*hook)());
+
+// Move the clock forward without sleeping (time spent busy, like a byte
+// going out on the UART)
+void simAdvance(uint64_t us);
+
+// Total time the clock moved while busy: halDelay() and simAdvance()
+uint64_t simBusyUs();
+
+// The 1 KB EEPROM image
+uint8_t *simEeprom();
+
+#endif
@@ -0,0 +1,5 @@
+# PlatformIO passes build_flags to the compiler only; the sanitizer
+# runtimes have to be linked as well
+Import("env")
+
+env.Append(LINKFLAGS=[f for f in env["CCFLAGS"] if f.startswith("-fsanitize")])
@@ -0,0 +1,286 @@
+#include <Arduino.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include "hal.h"
+#include "hal_native.h"
+#include "trace.h"
+
+// ==================== NATIVE SIMULATOR ====================
+// Runs setup() and loop() on the virtual board from hal_native.cpp:
+//
+//   pio run -e native
+//   .pio/build/native/program --days 7 --on < commands.txt
+//
+//   --days N        Virtual days to run (default 1)
+//   --start T       RTC start time, YYYY-MM-DDTHH:MM:SS (default
+//                   2025-01-06T07:55:00, a Monday)
+//   --on            Slide the power switch ON right after setup()
+//   --screen        Print every changed screen to stderr
+//   --eeprom FILE   Load the EEPROM image from FILE, save it back at the end
+//   --wire          Serial bytes take real time at the current baud rate
+//   --bench N       Time N GET_ALARMS + GET_STATUS round trips at each baud
+//                   rate SET_BAUD offers (implies --wire and --on)
+//   --trace FILE    Replay a recorded trace and report latencies (see
+//                   trace.h). Exits with 1 if a limit in it failed.
+//   --record FILE   Write this run's inputs to FILE as a trace
+//   --reset CAUSE   Boot as after a watchdog or brownout reset: the power
+//                   switch is already ON (use with --eeprom to resume a
+//                   reminder that was ringing when the last run ended)
+//
+// Whatever comes in on stdin is sent to the serial port at startup, and
+// everything the firmware sends comes out on stdout.
+
+void setup();
+void loop();
+
+extern Display display;
+
+// Days from 2000-01-01 to y-m-d (proleptic Gregorian)
+static uint32_t daysSince2000(int y, int m, int d)
+{
+  y -= m <= 2;
+  int era = y / 400;
+  int yoe = y - era * 400;
+  int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (uint32_t)(era * 146097 + doe - 730425); // 730425 = 2000-03-01 .. 0000-03-01
+}
+
+// ---- Baud rate benchmark ----
+// The host sends the next request the moment the last reply line is in
+// (set up from inside HostSerial::write()), so no time is lost between
+// passes.
+static unsigned long benchLeft;    // Round trips still to send
+static unsigned long benchPending; // Reply lines still expected
+static uint64_t benchLastReply;
+
+static void benchSend()
+{
+  Serial.inject("GET_ALARMS\nGET_STATUS\n", 22, Serial.lineDoneUs);
+  benchLeft--;
+  benchPending = 2;
+}
+
+static void benchOnReply()
+{
+  benchLastReply = Serial.lineDoneUs;
+  if (benchPending > 0 && --benchPending == 0 && benchLeft > 0)
+    benchSend();
+}
+
+// Run loop() until the expected replies are in, or `timeoutUs` passes
+static bool benchWait(uint64_t timeoutUs)
+{
+  uint64_t end = simMicros() + timeoutUs;
+  while (benchPending > 0 && simMicros() < end)
+    loop();
+  return benchPending == 0;
+}
+
+// Round trips per second, the way a host that waits for each reply sees it
+static void runBench(unsigned long rounds)
+{
+  static const unsigned long rates[] = {9600, 19200, 38400, 57600, 115200, 250000};
+  char line[32];
+
+  Serial.onReplyLine = benchOnReply;
+  printf("# %lu x GET_ALARMS + GET_STATUS per rate\n", rounds);
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+  {
+    if (rates[r] != Serial.hostBaud)
+    {
+      snprintf(line, sizeof(line), "SET_BAUD:%lu\n", rates[r]);
+      benchLeft = 0;
+      benchPending = 1;
+      Serial.inject(line, strlen(line));
+      if (!benchWait(5000000ULL))
+        break;
+      Serial.hostBaud = rates[r]; // Switch once the OK is in
+    }
+
+    uint64_t start = simMicros();
+    benchLeft = rounds;
+    benchSend();
+    bool ok = benchWait(rounds * 5000000ULL);
+    unsigned long done = rounds - benchLeft - (benchPending > 0 ? 1 : 0);
+    double seconds = (benchLastReply - start) / 1e6;
+    printf("%6lu baud: %7.1f transactions/s (%.2f ms each)%s\n", rates[r],
+           done / seconds, seconds * 1000.0 / done, ok ? "" : " - TIMED OUT");
+  }
+  Serial.onReplyLine = NULL;
+}
+
+static bool parseStart(const char *s, uint32_t &seconds)
+{
+  int y, mo, d, h, mi, sec;
+  if (sscanf(s, "%d-%d-%dT%d:%d:%d", &y, &mo, &d, &h, &mi, &sec) != 6 || y < 2000)
+    return false;
+  seconds = daysSince2000(y, mo, d) * 86400UL + h * 3600UL + mi * 60UL + sec;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  double days = 1;
+  uint32_t start = daysSince2000(2025, 1, 6) * 86400UL + 7 * 3600UL + 55 * 60UL;
+  bool on = false;
+  const char *eepromFile = NULL;
+  unsigned long benchRounds = 0;
+  const char *tracePath = NULL;
+  const char *startText = "2025-01-06T07:55:00";
+  uint8_t resetFlags = 0;
+  std::string input; // From stdin, for --record
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--days") && i + 1 < argc)
+      days = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--start") && i + 1 < argc && parseStart(argv[i + 1], start))
+      startText = argv[++i];
+    else if (!strcmp(argv[i], "--on"))
+      on = true;
+    else if (!strcmp(argv[i], "--screen"))
+      display.dumpTo = stderr;
+    else if (!strcmp(argv[i], "--eeprom") && i + 1 < argc)
+      eepromFile = argv[++i];
+    else if (!strcmp(argv[i], "--wire"))
+      Serial.wire = true;
+    else if (!strcmp(argv[i], "--bench") && i + 1 < argc)
+      benchRounds = strtoul(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--trace") && i + 1 < argc)
+      tracePath = argv[++i];
+    else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+    {
+      FILE *f = fopen(argv[++i], "w");
+      if (!f)
+      {
+        fprintf(stderr, "%s: can't write\n", argv[i]);
+        return 2;
+      }
+      traceRecordOpen(f);
+    }
+    else if (!strcmp(argv[i], "--reset") && i + 1 < argc && !strcmp(argv[i + 1], "watchdog"))
+    {
+      resetFlags = HAL_RESET_WATCHDOG;
+      i++;
+    }
+    else if (!strcmp(argv[i], "--reset") && i + 1 < argc && !strcmp(argv[i + 1], "brownout"))
+    {
+      resetFlags = HAL_RESET_BROWNOUT;
+      i++;
+    }
+    else
+    {
+      fprintf(stderr, "usage: %s [--days N] [--start YYYY-MM-DDTHH:MM:SS] [--on] [--screen] [--eeprom FILE] [--wire] [--bench N] [--trace FILE] [--record FILE] [--reset watchdog|brownout]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (tracePath)
+  {
+    if (!traceLoad(tracePath))
+      return 2;
+    if (traceRtc() && !parseStart(traceRtc(), start))
+    {
+      fprintf(stderr, "%s: bad rtc time %s\n", tracePath, traceRtc());
+      return 2;
+    }
+    if (traceRtc())
+      startText = traceRtc();
+    Serial.wire = Serial.wire || traceWire();
+    Serial.echo = false; // stdout is for the report
+  }
+
+  if (eepromFile)
+  {
+    FILE *f = fopen(eepromFile, "rb");
+    if (f)
+    {
+      fread(simEeprom(), 1, HAL_EEPROM_SIZE, f);
+      fclose(f);
+    }
+  }
+
+  traceRecordRtc(startText);
+  if (Serial.wire)
+    traceRecordWire();
+  if (benchRounds > 0)
+  {
+    Serial.wire = true;
+    Serial.echo = false;
+    on = true;
+  }
+  else if (!tracePath && !isatty(0))
+  {
+    char buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), stdin)) > 0)
+    {
+      Serial.inject(buf, n);
+      input.append(buf, n);
+    }
+  }
+
+  simSetRtc(start);
+  simSetPin(A1, LOW); // Slide switch OFF at boot, like the firmware expects
+  if (resetFlags)
+  {
+    simSetResetFlags(resetFlags);
+    simSetPin(A1, HIGH); // It was running - the switch is still ON
+    on = false;
+  }
+
+  uint64_t endUs = (uint64_t)(days * 86400e6);
+  simSetWakeAt(endUs);
+
+  clock_t wallStart = clock();
+  unsigned long passes = 0;
+  setup();
+  traceRecordStart();
+  if (!input.empty())
+    traceRecordSend(input.data(), input.size()); // The firmware reads it from here on
+  if (on)
+  {
+    loop(); // The firmware only acts on a change, so let it see OFF first
+    passes++;
+    simSetPin(A1, HIGH); // Slide it ON
+    traceRecordSwitch(true);
+  }
+  int result = 0;
+  if (tracePath)
+  {
+    result = traceRun(passes);
+    endUs = simMicros();
+  }
+  if (benchRounds > 0)
+  {
+    simSetWakeAt(UINT64_MAX);
+    for (int i = 0; i < 30; i++) // Let the power-on screen and logs settle
+      loop();
+    runBench(benchRounds);
+    endUs = simMicros();
+  }
+  while (simMicros() < endUs)
+  {
+    loop();
+    passes++;
+  }
+  fflush(stdout);
+
+  fprintf(stderr, "# simulated %.2f days in %.0f ms: %lu loop passes, %lu screen updates\n",
+          simMicros() / 86400e6, (clock() - wallStart) * 1000.0 / CLOCKS_PER_SEC,
+          passes, (unsigned long)display.frames);
+
+  if (eepromFile)
+  {
+    FILE *f = fopen(eepromFile, "wb");
+    if (f)
+    {
+      fwrite(simEeprom(), 1, HAL_EEPROM_SIZE, f);
+      fclose(f);
+    }
+  }
+  return result;
+}
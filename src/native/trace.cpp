@@ -0,0 +1,611 @@
+#include "trace.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "hal_native.h"
+
+void loop();
+extern Display display;
+
+// Same pins as main.cpp / diagram.json
+struct TracePin
+{
+  const char *name;
+  uint8_t pin;
+};
+
+static const TracePin tracePins[] = {
+    {"up", 10}, {"down", 11}, {"set", 12}, {"confirm", 13}, {"home", A0}, {"switch", A1}};
+
+enum TraceOp
+{
+  TRACE_PIN,
+  TRACE_SEND,
+  TRACE_EXPECT
+};
+
+struct TraceEvent
+{
+  uint64_t atUs;
+  uint8_t op;
+  uint8_t pin;
+  uint8_t level;
+  bool absolute;    // atUs counts from power-up, not from the end of setup()
+  bool screen;      // TRACE_EXPECT: screen or serial
+  std::string name; // TRACE_EXPECT
+  std::string text; // TRACE_SEND bytes / TRACE_EXPECT text, spaces removed
+};
+
+struct TraceLimit
+{
+  std::string name;
+  uint8_t percentile; // 50, 99 or 100 (max)
+  double ms;
+};
+
+struct TraceStat
+{
+  std::vector<uint32_t> us;
+  unsigned missed;
+};
+
+struct TracePending
+{
+  std::string name;
+  std::string text;
+  bool screen;
+  uint64_t startUs;
+};
+
+static std::vector<TraceEvent> events;
+static std::vector<TraceLimit> limits;
+static std::string rtcLine;
+static bool wireMode = false;
+
+static std::vector<std::string> statOrder; // Report in order of first use
+static std::map<std::string, TraceStat> stats;
+static std::vector<TracePending> pending;
+
+static FILE *recordTo = NULL;
+static uint64_t recordBaseUs = 0;
+
+// ---- Parsing ----
+static std::string withoutSpaces(const std::string &s)
+{
+  std::string out;
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    if (s[i] != ' ')
+      out += s[i];
+  }
+  return out;
+}
+
+static bool unescape(const std::string &s, std::string &out)
+{
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    if (s[i] != '\\')
+    {
+      out += s[i];
+      continue;
+    }
+    if (++i >= s.size())
+      return false;
+    switch (s[i])
+    {
+    case 'n':
+      out += '\n';
+      break;
+    case 'r':
+      out += '\r';
+      break;
+    case '\\':
+      out += '\\';
+      break;
+    case 'x':
+      if (i + 2 >= s.size())
+        return false;
+      out += (char)strtoul(s.substr(i + 1, 2).c_str(), NULL, 16);
+      i += 2;
+      break;
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+static int pinByName(const std::string &name)
+{
+  for (size_t i = 0; i < sizeof(tracePins) / sizeof(tracePins[0]); i++)
+  {
+    if (name == tracePins[i].name)
+      return tracePins[i].pin;
+  }
+  return -1;
+}
+
+static void addStat(const std::string &name)
+{
+  if (stats.find(name) == stats.end())
+  {
+    statOrder.push_back(name);
+    stats[name].missed = 0;
+  }
+}
+
+// One timed line, already split into time / command / rest of the line
+static bool parseTimed(uint64_t atUs, bool absolute, const std::string &cmd, const std::string &rest)
+{
+  TraceEvent ev;
+  ev.atUs = atUs;
+  ev.absolute = absolute;
+  ev.op = TRACE_PIN;
+  ev.pin = 0;
+  ev.level = LOW;
+  ev.screen = false;
+
+  char arg1[32] = "", arg2[32] = "";
+  sscanf(rest.c_str(), "%31s %31s", arg1, arg2);
+
+  if (cmd == "switch")
+  {
+    if (strcmp(arg1, "on") && strcmp(arg1, "off"))
+      return false;
+    ev.pin = A1;
+    ev.level = strcmp(arg1, "on") ? LOW : HIGH;
+    events.push_back(ev);
+    return true;
+  }
+
+  if (cmd == "press" || cmd == "down" || cmd == "up")
+  {
+    int pin = pinByName(arg1);
+    if (pin < 0 || pin == A1)
+      return false;
+    ev.pin = pin;
+    ev.level = (cmd == "up") ? HIGH : LOW; // Active LOW
+    events.push_back(ev);
+    if (cmd == "press")
+    {
+      ev.atUs += TRACE_PRESS_MS * 1000ULL;
+      ev.level = HIGH;
+      events.push_back(ev);
+    }
+    return true;
+  }
+
+  if (cmd == "send")
+  {
+    ev.op = TRACE_SEND;
+    if (!unescape(rest, ev.text) || ev.text.empty())
+      return false;
+    events.push_back(ev);
+    return true;
+  }
+
+  if (cmd == "expect")
+  {
+    // name, serial|screen, then the text to the end of the line
+    size_t kindAt = rest.find(' ');
+    if (kindAt == std::string::npos)
+      return false;
+    size_t textAt = rest.find(' ', kindAt + 1);
+    if (textAt == std::string::npos)
+      return false;
+    std::string kind = rest.substr(kindAt + 1, textAt - kindAt - 1);
+    if (kind != "serial" && kind != "screen")
+      return false;
+    ev.op = TRACE_EXPECT;
+    ev.name = rest.substr(0, kindAt);
+    ev.screen = (kind == "screen");
+    ev.text = withoutSpaces(rest.substr(textAt + 1));
+    if (ev.text.empty())
+      return false;
+    addStat(ev.name);
+    events.push_back(ev);
+    return true;
+  }
+
+  return false;
+}
+
+// Seconds since midnight of "HH:MM:SS"
+static bool secondOfDay(const char *s, long &seconds)
+{
+  int h, m, sec;
+  if (!s || sscanf(s, "%d:%d:%d", &h, &m, &sec) != 3)
+    return false;
+  seconds = h * 3600L + m * 60L + sec;
+  return true;
+}
+
+// Split "<ms> <cmd> <rest>" or "@HH:MM:SS <cmd> <rest>" and parse it,
+// `baseUs` later
+static bool parseLine(const std::string &line, uint64_t baseUs)
+{
+  char *end;
+  uint64_t atUs;
+  bool absolute = (line[0] == '@');
+  if (absolute)
+  {
+    // RTC time on the day the trace starts: needs the `rtc` line first
+    long rtcAt, at;
+    const char *rtcTime = strchr(rtcLine.c_str(), 'T');
+    end = (char *)strchr(line.c_str(), ' ');
+    if (baseUs != 0 || !rtcTime || !end || !secondOfDay(rtcTime + 1, rtcAt) ||
+        !secondOfDay(line.c_str() + 1, at) || at < rtcAt)
+      return false;
+    atUs = (at - rtcAt) * 1000000ULL;
+  }
+  else
+  {
+    double ms = strtod(line.c_str(), &end);
+    if (end == line.c_str() || ms < 0)
+      return false;
+    atUs = baseUs + (uint64_t)(ms * 1000);
+  }
+  std::string tail(end);
+  size_t cmdAt = tail.find_first_not_of(' ');
+  if (cmdAt == std::string::npos)
+    return false;
+  size_t restAt = tail.find(' ', cmdAt);
+  std::string cmd = tail.substr(cmdAt, restAt == std::string::npos ? std::string::npos : restAt - cmdAt);
+  std::string rest;
+  if (restAt != std::string::npos)
+  {
+    rest = tail.substr(restAt + 1);
+    rest.erase(0, rest.find_first_not_of(' '));
+  }
+  return parseTimed(atUs, absolute, cmd, rest);
+}
+
+static bool orderByTime(const TraceEvent &a, const TraceEvent &b)
+{
+  return a.atUs < b.atUs;
+}
+
+bool traceLoad(const char *path)
+{
+  FILE *f = fopen(path, "r");
+  if (!f)
+  {
+    fprintf(stderr, "%s: can't open\n", path);
+    return false;
+  }
+
+  char buf[256];
+  unsigned lineNo = 0;
+  std::vector<std::string> block; // Lines of a repeat block
+  unsigned repeatCount = 0;
+  double repeatAt = 0, repeatEvery = 0;
+  bool inRepeat = false;
+  bool ok = true;
+
+  while (ok && fgets(buf, sizeof(buf), f))
+  {
+    lineNo++;
+    std::string line(buf);
+    while (!line.empty() && (line[line.size() - 1] == '\n' || line[line.size() - 1] == '\r'))
+      line.erase(line.size() - 1);
+    size_t first = line.find_first_not_of(' ');
+    if (first == std::string::npos || line[first] == '#')
+      continue;
+    line.erase(0, first);
+
+    char word[32] = "", name[32] = "", which[8] = "";
+    double a = 0, b = 0;
+    sscanf(line.c_str(), "%31s", word);
+
+    if (inRepeat && strcmp(word, "end"))
+    {
+      block.push_back(line);
+    }
+    else if (!strcmp(word, "end"))
+    {
+      for (unsigned k = 0; ok && k < repeatCount; k++)
+      {
+        for (size_t i = 0; ok && i < block.size(); i++)
+          ok = parseLine(block[i], (uint64_t)((repeatAt + k * repeatEvery) * 1000));
+      }
+      ok = ok && inRepeat;
+      inRepeat = false;
+      block.clear();
+    }
+    else if (!strcmp(word, "rtc"))
+    {
+      rtcLine = line.substr(3);
+      rtcLine.erase(0, rtcLine.find_first_not_of(' '));
+    }
+    else if (!strcmp(word, "wire"))
+    {
+      wireMode = true;
+    }
+    else if (!strcmp(word, "limit"))
+    {
+      ok = sscanf(line.c_str(), "limit %31s %7s %lf", name, which, &a) == 3;
+      TraceLimit limit;
+      limit.name = name;
+      limit.ms = a;
+      if (!strcmp(which, "p50"))
+        limit.percentile = 50;
+      else if (!strcmp(which, "p99"))
+        limit.percentile = 99;
+      else if (!strcmp(which, "max"))
+        limit.percentile = 100;
+      else
+        ok = false;
+      limits.push_back(limit);
+    }
+    else if (sscanf(line.c_str(), "%lf repeat %u %lf", &a, &repeatCount, &b) == 3)
+    {
+      repeatAt = a;
+      repeatEvery = b;
+      inRepeat = true;
+    }
+    else
+    {
+      ok = parseLine(line, 0);
+    }
+
+    if (!ok)
+      fprintf(stderr, "%s:%u: can't read \"%s\"\n", path, lineNo, line.c_str());
+  }
+  fclose(f);
+
+  if (ok && inRepeat)
+  {
+    fprintf(stderr, "%s: repeat without end\n", path);
+    ok = false;
+  }
+  addStat("loop");
+  return ok;
+}
+
+const char *traceRtc()
+{
+  return rtcLine.empty() ? NULL : rtcLine.c_str();
+}
+
+bool traceWire()
+{
+  return wireMode;
+}
+
+// ---- Matching ----
+// End the oldest pending sample of each name whose text is in `seen`,
+// as of atUs
+static void match(const std::string &seen, bool screen, uint64_t atUs)
+{
+  std::vector<std::string> done;
+  for (size_t i = 0; i < pending.size();)
+  {
+    TracePending &p = pending[i];
+    if (p.screen == screen && seen.find(p.text) != std::string::npos &&
+        std::find(done.begin(), done.end(), p.name) == done.end())
+    {
+      stats[p.name].us.push_back((uint32_t)(atUs - p.startUs));
+      done.push_back(p.name);
+      pending.erase(pending.begin() + i);
+    }
+    else
+    {
+      i++;
+    }
+  }
+}
+
+static void onLine(const char *line)
+{
+  match(withoutSpaces(line), false, Serial.lineDoneUs); // Once the host has it
+}
+
+static void onFrame()
+{
+  std::string rows;
+  for (uint8_t r = 0; r < SINK_ROWS; r++)
+    rows += display.row(r);
+  match(withoutSpaces(rows), true, display.shownUs); // Once it's all on the panel
+}
+
+static void dropMisses(uint64_t now)
+{
+  for (size_t i = 0; i < pending.size();)
+  {
+    if (now - pending[i].startUs > TRACE_MISS_MS * 1000ULL)
+    {
+      stats[pending[i].name].missed++;
+      pending.erase(pending.begin() + i);
+    }
+    else
+    {
+      i++;
+    }
+  }
+}
+
+// ---- Recording ----
+void traceRecordOpen(FILE *f)
+{
+  recordTo = f;
+}
+
+void traceRecordStart()
+{
+  recordBaseUs = simMicros();
+}
+
+// Trace time of "now" for a recorded line
+static double recordMs()
+{
+  return (simMicros() - recordBaseUs) / 1000.0;
+}
+
+void traceRecordRtc(const char *when)
+{
+  if (recordTo)
+    fprintf(recordTo, "rtc %s\n", when);
+}
+
+void traceRecordWire()
+{
+  if (recordTo)
+    fputs("wire\n", recordTo);
+}
+
+void traceRecordSwitch(bool on)
+{
+  if (recordTo)
+    fprintf(recordTo, "%.1f switch %s\n", recordMs(), on ? "on" : "off");
+}
+
+void traceRecordSend(const char *s, size_t len)
+{
+  if (!recordTo)
+    return;
+  fprintf(recordTo, "%.1f send ", recordMs());
+  for (size_t i = 0; i < len; i++)
+  {
+    uint8_t c = (uint8_t)s[i];
+    if (c == '\n')
+      fputs("\\n", recordTo);
+    else if (c == '\r')
+      fputs("\\r", recordTo);
+    else if (c == '\\')
+      fputs("\\\\", recordTo);
+    else if (c < 0x20 || c >= 0x7F)
+      fprintf(recordTo, "\\x%02X", c);
+    else
+      fputc(c, recordTo);
+  }
+  fputc('\n', recordTo);
+}
+
+static void recordPin(uint8_t pin, uint8_t level)
+{
+  if (!recordTo)
+    return;
+  if (pin == A1)
+  {
+    traceRecordSwitch(level == HIGH);
+    return;
+  }
+  for (size_t i = 0; i < sizeof(tracePins) / sizeof(tracePins[0]); i++)
+  {
+    if (tracePins[i].pin == pin)
+      fprintf(recordTo, "%.1f %s %s\n", recordMs(), level == LOW ? "down" : "up",
+              tracePins[i].name);
+  }
+}
+
+// ---- Replay ----
+static void apply(const TraceEvent &ev)
+{
+  if (ev.op == TRACE_PIN)
+  {
+    simSetPin(ev.pin, ev.level);
+    recordPin(ev.pin, ev.level);
+  }
+  else if (ev.op == TRACE_SEND)
+  {
+    Serial.inject(ev.text.data(), ev.text.size());
+    traceRecordSend(ev.text.data(), ev.text.size());
+  }
+  else
+  {
+    TracePending p;
+    p.name = ev.name;
+    p.text = ev.text;
+    p.screen = ev.screen;
+    p.startUs = ev.atUs;
+    pending.push_back(p);
+  }
+}
+
+static uint64_t traceEndUs;
+static size_t nextEvent;
+
+// Apply everything that is due, then sleep no further than the next event
+static void applyDue()
+{
+  while (nextEvent < events.size() && events[nextEvent].atUs <= simMicros())
+    apply(events[nextEvent++]);
+  simSetWakeAt(nextEvent < events.size() ? events[nextEvent].atUs : traceEndUs);
+}
+
+// Nearest-rank percentile of sorted samples, in ms
+static double percentileMs(const std::vector<uint32_t> &sorted, uint8_t p)
+{
+  if (sorted.empty())
+    return 0;
+  size_t rank = (sorted.size() * p + 99) / 100;
+  return sorted[rank > 0 ? rank - 1 : 0] / 1000.0;
+}
+
+int traceRun(unsigned long &passes)
+{
+  Serial.onLine = onLine;
+  display.onFrame = onFrame;
+
+  // Trace times count from the end of setup()
+  uint64_t baseUs = simMicros();
+  uint64_t endUs = 0;
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    if (!events[i].absolute)
+      events[i].atUs += baseUs;
+    uint64_t last = events[i].atUs + (events[i].op == TRACE_EXPECT ? TRACE_MISS_MS * 1000ULL : 0);
+    if (last > endUs)
+      endUs = last;
+  }
+  traceEndUs = endUs + 1000000ULL;
+  std::stable_sort(events.begin(), events.end(), orderByTime);
+
+  // Inputs change when they are due, also while the firmware sleeps or
+  // waits in halDelay()
+  std::vector<uint32_t> &loopUs = stats["loop"].us;
+  nextEvent = 0;
+  simOnWake(applyDue);
+  while (simMicros() < traceEndUs)
+  {
+    applyDue();
+    uint64_t busy = simBusyUs();
+    loop();
+    passes++;
+    loopUs.push_back((uint32_t)(simBusyUs() - busy));
+    dropMisses(simMicros());
+  }
+  dropMisses(UINT64_MAX / 2);
+  simOnWake(NULL);
+  Serial.onLine = NULL;
+  display.onFrame = NULL;
+
+  // ---- Report ----
+  int result = 0;
+  printf("%-20s %7s %6s %9s %9s %9s\n", "latency", "samples", "missed", "p50 ms", "p99 ms", "max ms");
+  for (size_t i = 0; i < statOrder.size(); i++)
+  {
+    TraceStat &s = stats[statOrder[i]];
+    std::sort(s.us.begin(), s.us.end());
+    printf("%-20s %7u %6u %9.1f %9.1f %9.1f\n", statOrder[i].c_str(), (unsigned)s.us.size(),
+           s.missed, percentileMs(s.us, 50), percentileMs(s.us, 99), percentileMs(s.us, 100));
+    if (s.missed > 0)
+      result = 1;
+  }
+
+  for (size_t i = 0; i < limits.size(); i++)
+  {
+    const TraceLimit &l = limits[i];
+    std::map<std::string, TraceStat>::iterator s = stats.find(l.name);
+    double got = (s == stats.end()) ? 0 : percentileMs(s->second.us, l.percentile);
+    bool pass = (s != stats.end()) && !s->second.us.empty() && got <= l.ms;
+    printf("%s %s %s %.1f ms (limit %.1f ms)\n", pass ? "PASS" : "FAIL", l.name.c_str(),
+           l.percentile == 100 ? "max" : (l.percentile == 99 ? "p99" : "p50"), got, l.ms);
+    if (!pass)
+      result = 1;
+  }
+  return result;
+}
@@ -0,0 +1,66 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+// ==================== TRACE REPLAY + LATENCY BENCHMARK ====================
+// A trace is a text file of timestamped inputs for the virtual board, the
+// latencies to measure and the limits they must stay under. Seed traces
+// are in src/native/traces/.
+//
+//   # comment
+//   rtc 2025-01-06T07:59:30   RTC time at the start (set before setup())
+//   wire                      Serial bytes take real time (like --wire)
+//   <ms> switch on|off        Slide the power switch
+//   <ms> press <button>       up, down, set, confirm or home: pressed now,
+//                             released TRACE_PRESS_MS later
+//   <ms> down|up <button>     A single edge
+//   <ms> send <text>          Serial bytes, with \n \r \\ \xNN escapes
+//   <ms> expect <name> serial|screen <text>
+//                             Start a latency sample called <name>. It
+//                             ends at the first serial line (log lines
+//                             too) or changed screen that contains <text>,
+//                             spaces ignored. A line or screen ends at most
+//                             one sample per name, the oldest. No match
+//                             within TRACE_MISS_MS counts as a miss.
+//   @HH:MM:SS <command>       Any of the above at an RTC time instead, on
+//                             the day of the `rtc` line (not in a repeat)
+//   <ms> repeat <n> <every>   The lines up to `end` n times, <every> ms
+//   end                       apart. Their times count from <ms> + k*every.
+//   limit <name> p50|p99|max <ms>
+//                             Fail the run if the latency goes over
+//
+// <ms> is virtual milliseconds since setup() returned. Each pass of loop()
+// is also measured as "loop": the time it kept the CPU busy before going
+// to sleep (halDelay(), and bytes on the wire in wire mode) - the worst
+// loop stall. Computation itself takes no virtual time.
+
+#define TRACE_PRESS_MS 80
+#define TRACE_MISS_MS 10000
+
+// Read a trace. False (and a message on stderr) if it doesn't parse.
+bool traceLoad(const char *path);
+
+// The trace's `rtc` line, or NULL
+const char *traceRtc();
+
+// True if the trace asked for wire mode
+bool traceWire();
+
+// Run loop() through the trace and print the latency report, counting
+// loop() passes in `passes`. Returns the process exit code: 0 = every
+// limit held, 1 = a limit failed or an expected reply never came.
+int traceRun(unsigned long &passes);
+
+// ---- Recording ----
+// Inputs the simulator delivers are also written to `f` in trace format,
+// so a run can be replayed later. Times count from traceRecordStart(),
+// which the simulator calls when setup() returns.
+void traceRecordOpen(FILE *f);
+void traceRecordStart();
+void traceRecordRtc(const char *when);
+void traceRecordWire();
+void traceRecordSwitch(bool on);
+void traceRecordSend(const char *s, size_t len);
+
+#endif
@@ -0,0 +1,404 @@
+#include "oled.h"
+#include "big_font.h"
+#include "crc16.h"
+#include "perf.h"
+
+// Page transaction head: four commands, each behind a "one command
+// byte follows" control byte (0x80), then 0x40 - data stream to the end
+#define OLED_CMD 0x80
+#define OLED_DATA 0x40
+
+// What Adafruit's display() puts on the bus for one frame:
+// 1 command transaction (addr + 0x00 + 6 bytes) and 34 data transactions
+// of up to 31 bytes (addr + 0x40 each)
+#define OLED_FULL_FRAME_BYTES (8 + 1024 + 34 * 2)
+
+// Draw list entries (page mode). Any other byte is a character to print,
+// so the font's control-code glyphs 1-3 can't be printed in page mode.
+#define OP_CURSOR 0x01 // x, y
+#define OP_SIZE 0x02   // text size
+#define OP_COLOR 0x03  // text color
+
+Oled::Oled(uint8_t w, uint8_t h)
+    : Adafruit_GFX(w, h),
+      sentPerSec(0), fullPerSec(0), renderUs(0), i2caddr(0), vccstate(SSD1306_SWITCHCAPVCC),
+      fullRefresh(true), resend(false), bytesSent(0), bytesFull(0), statsStart(0), frameStart(0)
+#if OLED_PAGE_MODE
+      ,
+      pageBuf(pageBufs[0]), listLen(0), rasterPage(-1),
+      startX(0), startY(0), startSize(1), startColor(SSD1306_WHITE)
+#else
+      ,
+      buffer(NULL)
+#endif
+{
+  memset(txns, 0, sizeof(txns)); // All TWI_DONE - free
+}
+
+// Adafruit_SSD1306::begin() for a 128x64 panel
+static const uint8_t initCommands[] PROGMEM = {
+    SSD1306_DISPLAYOFF,
+    SSD1306_SETDISPLAYCLOCKDIV, 0x80,
+    SSD1306_SETMULTIPLEX, 63,
+    SSD1306_SETDISPLAYOFFSET, 0x00,
+    SSD1306_SETSTARTLINE | 0x00,
+    SSD1306_CHARGEPUMP, 0x14,   // 0x10 with SSD1306_EXTERNALVCC
+    SSD1306_MEMORYMODE, 0x00,   // Horizontal addressing
+    SSD1306_SEGREMAP | 0x01,
+    SSD1306_COMSCANDEC,
+    SSD1306_SETCOMPINS, 0x12,
+    SSD1306_SETCONTRAST, 0xCF,  // 0x9F with SSD1306_EXTERNALVCC
+    SSD1306_SETPRECHARGE, 0xF1, // 0x22 with SSD1306_EXTERNALVCC
+    SSD1306_SETVCOMDETECT, 0x40,
+    SSD1306_DISPLAYALLON_RESUME,
+    SSD1306_NORMALDISPLAY,
+    SSD1306_DEACTIVATE_SCROLL,
+    SSD1306_DISPLAYON,
+};
+
+bool Oled::begin(uint8_t vcc, uint8_t addr)
+{
+#if !OLED_PAGE_MODE
+  if (!buffer)
+    buffer = (uint8_t *)malloc((uint16_t)WIDTH * ((HEIGHT + 7) / 8));
+  if (!buffer)
+    return false;
+  memset(buffer, 0, (uint16_t)WIDTH * ((HEIGHT + 7) / 8));
+#endif
+  vccstate = vcc;
+  i2caddr = addr;
+  bool external = (vcc == SSD1306_EXTERNALVCC);
+
+  // All of it fits one transaction: 0x00 (command stream) + 26 bytes
+  uint8_t cmds[sizeof(initCommands)];
+  for (uint8_t i = 0; i < sizeof(initCommands); i++)
+  {
+    uint8_t b = pgm_read_byte(&initCommands[i]);
+    if (external && i > 0)
+    {
+      uint8_t cmd = pgm_read_byte(&initCommands[i - 1]);
+      if (cmd == SSD1306_CHARGEPUMP)
+        b = 0x10;
+      else if (cmd == SSD1306_SETCONTRAST)
+        b = 0x9F;
+      else if (cmd == SSD1306_SETPRECHARGE)
+        b = 0x22;
+    }
+    cmds[i] = b;
+  }
+  TwiTxn &t = txns[0];
+  t.addr = i2caddr;
+  t.head[0] = 0x00;
+  t.headLen = 1;
+  t.data = cmds;
+  t.dataLen = sizeof(cmds);
+  t.readLen = 0;
+  twiSubmit(t);
+  bool ok = (twiWait(t) == TWI_DONE);
+  t.status = TWI_DONE;
+
+  fullRefresh = true; // Panel RAM holds noise until the first flush()
+  return ok;
+}
+
+uint16_t Oled::ramBytes() const
+{
+#if OLED_PAGE_MODE
+  return sizeof(pageBufs) + sizeof(drawList);
+#else
+  return (uint16_t)WIDTH * ((HEIGHT + 7) / 8);
+#endif
+}
+
+void Oled::clearDisplay()
+{
+#if OLED_PAGE_MODE
+  listLen = 0;
+  startX = cursor_x;
+  startY = cursor_y;
+  startSize = textsize_x;
+  startColor = textcolor;
+#else
+  // The last frame's pages are sent straight from the framebuffer
+  for (uint8_t i = 0; i < OLED_TXNS; i++)
+    reclaim(txns[i]);
+  if (buffer)
+    memset(buffer, 0, (uint16_t)WIDTH * ((HEIGHT + 7) / 8));
+#endif
+  frameStart = micros();
+}
+
+// True if the current text settings can use the big font (see big_font.h):
+// plain white text, square scaling, no rotation or custom font
+static inline bool bigFontUsable(uint16_t color, uint16_t bg, uint8_t sx, uint8_t sy,
+                                 const void *font, uint8_t rotation)
+{
+  return color == SSD1306_WHITE && bg == color && sx == sy && !font && !rotation;
+}
+
+// Same cursor and wrapping rules as Adafruit_GFX::write() for the built-in
+// font, but the glyph is OR-ed in from Flash (see big_font.h)
+size_t Oled::write(uint8_t c)
+{
+#if OLED_PAGE_MODE
+  if (rasterPage < 0)
+  {
+    if (c != '\r') // Adafruit_GFX ignores it too
+      record(c);
+    return 1;
+  }
+#endif
+
+  if (!bigFontUsable(textcolor, textbgcolor, textsize_x, textsize_y, gfxFont, rotation) ||
+      !bigFontHas(c, textsize_x))
+    return Adafruit_GFX::write(c);
+
+  if (wrap && cursor_x + textsize_x * 6 > _width)
+  {
+    cursor_x = 0;
+    cursor_y += textsize_y * 8;
+  }
+#if !OLED_PAGE_MODE
+  if (buffer)
+    bigFontDraw(buffer, 0, OLED_PAGES, cursor_x, cursor_y, c, textsize_x);
+#endif
+  cursor_x += textsize_x * 6;
+  return 1;
+}
+
+#if OLED_PAGE_MODE
+// ---- Page mode: recording ----
+void Oled::record(uint8_t b)
+{
+  if (listLen < OLED_DRAW_LIST_MAX)
+    drawList[listLen++] = b;
+}
+
+void Oled::setCursor(int16_t x, int16_t y)
+{
+  Adafruit_GFX::setCursor(x, y);
+  if (listLen + 3 <= OLED_DRAW_LIST_MAX)
+  {
+    record(OP_CURSOR);
+    record((uint8_t)x);
+    record((uint8_t)y);
+  }
+}
+
+void Oled::setTextSize(uint8_t size)
+{
+  Adafruit_GFX::setTextSize(size);
+  if (listLen + 2 <= OLED_DRAW_LIST_MAX)
+  {
+    record(OP_SIZE);
+    record(size);
+  }
+}
+
+void Oled::setTextColor(uint16_t color)
+{
+  Adafruit_GFX::setTextColor(color);
+  if (listLen + 2 <= OLED_DRAW_LIST_MAX)
+  {
+    record(OP_COLOR);
+    record((uint8_t)color);
+  }
+}
+
+// ---- Page mode: playback ----
+// Adafruit_GFX::write() for the built-in font, skipping characters that
+// don't reach into the page being rendered
+void Oled::putChar(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursor_x = 0;
+    cursor_y += textsize_y * 8;
+    return;
+  }
+  if (wrap && cursor_x + textsize_x * 6 > _width)
+  {
+    cursor_x = 0;
+    cursor_y += textsize_y * 8;
+  }
+
+  int16_t top = rasterPage * 8;
+  if (cursor_y < top + 8 && cursor_y + textsize_y * 8 > top)
+  {
+    if (!bigFontUsable(textcolor, textbgcolor, textsize_x, textsize_y, gfxFont, rotation) ||
+        !bigFontDraw(pageBuf, rasterPage, 1, cursor_x, cursor_y, c, textsize_x))
+      drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x);
+  }
+  cursor_x += textsize_x * 6;
+}
+
+// Play the draw list back into the page's buffer, clipped to one page.
+// The buffer may still be going out with the page before last - wait
+// for that first.
+void Oled::renderPage(uint8_t page)
+{
+  uint8_t slot = page % OLED_TXNS;
+  reclaim(txns[slot]);
+  pageBuf = pageBufs[slot];
+  memset(pageBuf, 0, sizeof(pageBufs[0]));
+  rasterPage = page;
+  Adafruit_GFX::setCursor(startX, startY);
+  Adafruit_GFX::setTextSize(startSize);
+  Adafruit_GFX::setTextColor(startColor);
+
+  for (uint8_t i = 0; i < listLen; i++)
+  {
+    uint8_t b = drawList[i];
+    if (b == OP_CURSOR)
+    {
+      Adafruit_GFX::setCursor(drawList[i + 1], drawList[i + 2]);
+      i += 2;
+    }
+    else if (b == OP_SIZE)
+    {
+      Adafruit_GFX::setTextSize(drawList[++i]);
+    }
+    else if (b == OP_COLOR)
+    {
+      Adafruit_GFX::setTextColor(drawList[++i]);
+    }
+    else
+    {
+      putChar(b);
+    }
+  }
+  rasterPage = -1;
+}
+
+#endif
+
+void Oled::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+#if OLED_PAGE_MODE
+  if (x < 0 || x >= WIDTH || y < 0 || (y >> 3) != rasterPage)
+    return;
+  uint8_t *b = &pageBuf[x];
+#else
+  if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT || !buffer)
+    return;
+  uint8_t *b = &buffer[x + (y >> 3) * WIDTH];
+#endif
+  uint8_t mask = 1 << (y & 7);
+  if (color == SSD1306_WHITE)
+    *b |= mask;
+  else if (color == SSD1306_BLACK)
+    *b &= ~mask;
+  else
+    *b ^= mask; // SSD1306_INVERSE
+}
+
+void Oled::invalidate()
+{
+  fullRefresh = true;
+}
+
+// Wait until txn is free again. A page that didn't make it leaves the
+// panel out of step with chunkCrc, so the next flush() sends everything.
+void Oled::reclaim(TwiTxn &txn)
+{
+  if (twiWait(txn) != TWI_DONE)
+  {
+    resend = true;
+    txn.status = TWI_DONE;
+  }
+}
+
+// Find the page's dirty chunks and queue one transaction for the columns
+// from the first to the last of them: window commands, then the bytes.
+// A clean chunk in between costs 16 bytes - less than a second
+// transaction's address and commands.
+void Oled::sendPage(uint8_t page, const uint8_t *row, TwiTxn &txn)
+{
+  int8_t first = -1;
+  int8_t last = -1;
+  for (uint8_t c = 0; c < OLED_CHUNKS_PER_PAGE; c++)
+  {
+    uint16_t crc = crc16(row + c * OLED_CHUNK_COLS, OLED_CHUNK_COLS);
+    if (fullRefresh || crc != chunkCrc[page][c])
+    {
+      chunkCrc[page][c] = crc;
+      if (first < 0)
+        first = c;
+      last = c;
+    }
+  }
+  if (first < 0)
+    return;
+
+  uint8_t col0 = first * OLED_CHUNK_COLS;
+  uint8_t col1 = (last + 1) * OLED_CHUNK_COLS - 1;
+  reclaim(txn);
+  uint8_t *h = txn.head;
+  h[0] = OLED_CMD;
+  h[1] = SSD1306_PAGEADDR;
+  h[2] = OLED_CMD;
+  h[3] = page;
+  h[4] = OLED_CMD;
+  h[5] = page;
+  h[6] = OLED_CMD;
+  h[7] = SSD1306_COLUMNADDR;
+  h[8] = OLED_CMD;
+  h[9] = col0;
+  h[10] = OLED_CMD;
+  h[11] = col1;
+  h[12] = OLED_DATA;
+  txn.headLen = 13;
+  txn.addr = i2caddr;
+  txn.data = row + col0;
+  txn.dataLen = col1 - col0 + 1;
+  txn.readLen = 0;
+  twiSubmit(txn);
+  bytesSent += 1 + txn.headLen + txn.dataLen; // Address byte too
+}
+
+void Oled::flush()
+{
+  unsigned long start = micros();
+  renderUs = start - frameStart;
+  unsigned long replayUs = 0;
+
+  // Pages of the last frame that failed: the panel missed them
+  for (uint8_t i = 0; i < OLED_TXNS; i++)
+    reclaim(txns[i]);
+  if (resend)
+  {
+    fullRefresh = true;
+    resend = false;
+  }
+
+  for (uint8_t page = 0; page < OLED_PAGES; page++)
+  {
+#if OLED_PAGE_MODE
+    unsigned long t = micros();
+    renderPage(page);
+    replayUs += micros() - t;
+    sendPage(page, pageBuf, txns[page % OLED_TXNS]);
+#else
+    if (buffer)
+      sendPage(page, buffer + page * 128, txns[page]);
+#endif
+  }
+  fullRefresh = false;
+
+  renderUs += replayUs;
+  PERF_ADD(PERF_RENDER, renderUs);
+  PERF_ADD(PERF_I2C, micros() - start - replayUs);
+
+  // Latch bytes/second once a second
+  bytesFull += OLED_FULL_FRAME_BYTES;
+  unsigned long now = millis();
+  unsigned long elapsed = now - statsStart;
+  if (elapsed >= 1000)
+  {
+    sentPerSec = bytesSent * 1000UL / elapsed;
+    fullPerSec = bytesFull * 1000UL / elapsed;
+    bytesSent = 0;
+    bytesFull = 0;
+    statsStart = now;
+  }
+}
@@ -0,0 +1,161 @@
+#include "perf.h"
+
+#if PERF_STATS
+#include "hal.h"
+
+// Upper limits of the loop histogram buckets in microseconds. The last
+// bucket takes everything longer.
+static const uint32_t bucketLimitUs[PERF_BUCKETS - 1] PROGMEM = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000};
+
+PerfStats perf = {{0}, {{0, 0, 0}}, 0, 0xFFFF};
+static unsigned long loopStart;
+
+// ---- Stack painting (AVR only) ----
+#if defined(__AVR__)
+#define STACK_PAINT 0xC5
+
+extern uint8_t __heap_start;
+extern char *__brkval; // avr-libc: top of the heap, 0 until the first malloc()
+
+static uint8_t *heapTop()
+{
+  return __brkval ? (uint8_t *)__brkval : &__heap_start;
+}
+
+// Paints _end (end of .bss) .. __stack (RAMEND) straight after reset: .init1
+// runs before the C runtime has set anything up or put anything on the
+// stack. Assembler, because not even r1 = 0 can be relied on yet.
+void perfPaintStack() __attribute__((naked, used, section(".init1")));
+void perfPaintStack()
+{
+  __asm volatile(
+      "    ldi r30, lo8(_end)\n"
+      "    ldi r31, hi8(_end)\n"
+      "    ldi r24, %0\n"
+      "    ldi r25, hi8(__stack)\n"
+      "    rjmp 2f\n"
+      "1:  st Z+, r24\n"
+      "2:  cpi r30, lo8(__stack)\n"
+      "    cpc r31, r25\n"
+      "    brlo 1b\n"
+      "    breq 1b\n" ::"M"(STACK_PAINT));
+}
+
+// Same again at run time, for RESET_PERF: everything below our own stack
+// frame is free. An interrupt may use some of it while we paint, which
+// just shows up as used - it was.
+static void repaintStack()
+{
+  uint8_t here;
+  uint8_t *end = &here - 16; // Keep clear of this function's own frame
+  for (uint8_t *p = heapTop(); p < end; p++)
+    *p = STACK_PAINT;
+}
+
+uint16_t perfFreeRam()
+{
+  uint8_t here;
+  return &here - heapTop();
+}
+
+uint16_t perfStackUnused()
+{
+  uint8_t here;
+  uint8_t *p = heapTop();
+  while (p < &here && *p == STACK_PAINT)
+    p++;
+  return p - heapTop();
+}
+#else
+static void repaintStack()
+{
+}
+
+uint16_t perfFreeRam()
+{
+  return 0;
+}
+
+uint16_t perfStackUnused()
+{
+  return 0;
+}
+#endif
+
+// ---- Counters ----
+uint16_t PerfSectionStats::avgUs() const
+{
+  if (count == 0)
+    return 0;
+  uint32_t avg = totalUs / count;
+  return avg > 0xFFFF ? 0xFFFF : avg;
+}
+
+static void noteFreeRam()
+{
+  uint16_t free = perfFreeRam();
+  if (free < perf.minFreeRam)
+    perf.minFreeRam = free;
+}
+
+void perfAdd(uint8_t section, uint32_t us)
+{
+  PerfSectionStats &s = perf.sections[section];
+  if (s.count == 0xFFFF || s.totalUs + us < s.totalUs)
+  {
+    s.count >>= 1;
+    s.totalUs >>= 1;
+  }
+  s.count++;
+  s.totalUs += us;
+  if (us > s.maxUs)
+    s.maxUs = us;
+  noteFreeRam();
+}
+
+void perfLoopStart()
+{
+  loopStart = halMicros();
+}
+
+void perfLoopEnd()
+{
+  uint32_t us = halMicros() - loopStart;
+  uint8_t b = 0;
+  while (b < PERF_BUCKETS - 1 && us >= pgm_read_dword(&bucketLimitUs[b]))
+    b++;
+
+  if (perf.loopHist[b] == 0xFFFF)
+  {
+    for (uint8_t i = 0; i < PERF_BUCKETS; i++)
+      perf.loopHist[i] >>= 1;
+  }
+  perf.loopHist[b]++;
+  noteFreeRam();
+}
+
+void perfRxBacklog(uint8_t waiting)
+{
+  if (waiting > perf.rxPeak)
+    perf.rxPeak = waiting;
+}
+
+void perfReset()
+{
+  memset(&perf, 0, sizeof(perf));
+  perf.minFreeRam = 0xFFFF;
+  repaintStack();
+  noteFreeRam();
+}
+
+PerfTimer::PerfTimer(uint8_t section) : section(section), start(halMicros())
+{
+}
+
+PerfTimer::~PerfTimer()
+{
+  perfAdd(section, halMicros() - start);
+}
+
+#endif
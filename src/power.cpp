@@ -0,0 +1,81 @@
+#include "power.h"
+#include "hal.h"
+
+// ---- Duty cycle window ----
+// Kept in whole milliseconds plus a microsecond remainder, so a window can
+// run far longer than the 71 minutes micros() takes to wrap.
+static uint32_t mark = 0;        // micros() at the last update
+static uint32_t awakeMs = 0;     // CPU running
+static uint32_t countedMs = 0;   // Everything micros() saw (awake + idle)
+static uint16_t awakeUs = 0;
+static uint16_t countedUs = 0;
+static uint16_t downSleeps = 0;
+
+// Add the time since the last call, awake or in idle sleep
+static void account(bool awake)
+{
+  uint32_t now = halMicros();
+  uint32_t d = now - mark;
+  mark = now;
+
+  countedMs += d / 1000;
+  countedUs += d % 1000;
+  if (countedUs >= 1000)
+  {
+    countedMs++;
+    countedUs -= 1000;
+  }
+  if (awake)
+  {
+    awakeMs += d / 1000;
+    awakeUs += d % 1000;
+    if (awakeUs >= 1000)
+    {
+      awakeMs++;
+      awakeUs -= 1000;
+    }
+  }
+}
+
+void powerBegin()
+{
+  mark = halMicros();
+}
+
+void powerIdle(unsigned long untilMs)
+{
+  account(true);
+  halSleepIdle(untilMs);
+  account(false);
+}
+
+bool powerDown()
+{
+  account(true);
+  downSleeps++;
+  bool rxWoke = halSleepPowerDown();
+  mark = halMicros(); // micros() stood still - nothing to add
+  return rxWoke;
+}
+
+void powerTakeStats(uint16_t rtcTicks, PowerStats &stats)
+{
+  account(true);
+
+  // Whole RTC seconds also cover the power-down time micros() missed
+  uint32_t totalMs = countedMs;
+  if ((uint32_t)rtcTicks * 1000UL > totalMs)
+    totalMs = (uint32_t)rtcTicks * 1000UL;
+
+  // awakeMs <= totalMs, so awakeMs * 1000 only overflows for huge windows
+  if (totalMs >= 1000000UL)
+    stats.awakePermille = (uint16_t)(awakeMs / (totalMs / 1000));
+  else
+    stats.awakePermille = totalMs ? (uint16_t)(awakeMs * 1000 / totalMs) : 0;
+  stats.seconds = (uint16_t)(totalMs / 1000);
+  stats.downSleeps = downSleeps;
+
+  awakeMs = countedMs = 0;
+  awakeUs = countedUs = 0;
+  downSleeps = 0;
+}
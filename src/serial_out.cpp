@@ -0,0 +1,98 @@
+#include "serial_out.h"
+
+SerialOut serialOut;
+
+SerialOut::SerialOut()
+    : stalls(0), head(0), count(0), open(0), depth(0), diagHead(0), diagCount(0), diagMid(false)
+{
+}
+
+void SerialOut::begin()
+{
+  depth++;
+}
+
+void SerialOut::end()
+{
+  if (!depth || --depth)
+    return;
+  count += open;
+  open = 0;
+  service(); // Start sending right away
+}
+
+size_t SerialOut::write(uint8_t c)
+{
+  if (count + open >= SEROUT_QUEUE_SIZE)
+  {
+    // The unit doesn't fit. Let go of what's printed of it so far (nothing
+    // else can get in between - log lines wait for end()) and wait for the
+    // UART to take enough of it.
+    stalls++;
+    count += open;
+    open = 0;
+    uint8_t b;
+    while (count >= SEROUT_QUEUE_SIZE && take(b))
+      Serial.write(b);
+  }
+
+  queue[wrap(head + count + open)] = c;
+  if (depth)
+    open++;
+  else
+    count++;
+  return 1;
+}
+
+bool SerialOut::writeDiag(const uint8_t *line, uint8_t len)
+{
+  if (SEROUT_DIAG_SIZE - diagCount < len)
+    return false;
+  for (uint8_t i = 0; i < len; i++)
+    diag[(diagHead + diagCount + i) % SEROUT_DIAG_SIZE] = line[i];
+  diagCount += len;
+  service();
+  return true;
+}
+
+// Next byte to send: finish a log line that's already started, then
+// replies and events, then log lines - but none while a unit is open, or
+// it could land between two halves of a unit that had to stall
+bool SerialOut::take(uint8_t &c)
+{
+  if (count && !diagMid)
+  {
+    c = queue[head];
+    head = wrap(head + 1);
+    count--;
+    return true;
+  }
+  if (diagCount && (diagMid || !depth))
+  {
+    c = diag[diagHead];
+    diagHead = (diagHead + 1) % SEROUT_DIAG_SIZE;
+    diagCount--;
+    diagMid = (c != '\n');
+    return true;
+  }
+  return false;
+}
+
+void SerialOut::service()
+{
+  int space = Serial.availableForWrite();
+  uint8_t c;
+  while (space > 0 && take(c))
+  {
+    Serial.write(c);
+    space--;
+  }
+}
+
+void SerialOut::drain()
+{
+  uint8_t c;
+  while (take(c))
+    Serial.write(c); // Waits for the TX buffer
+  Serial.flush();
+}
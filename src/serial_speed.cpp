@@ -0,0 +1,67 @@
+#include "serial_speed.h"
+#include "hal.h"
+#include "serial_out.h"
+
+static const uint32_t supportedRates[] PROGMEM = {9600, 19200, 38400, 57600, 115200, 250000};
+
+bool baudSupported(uint32_t rate)
+{
+  for (uint8_t i = 0; i < sizeof(supportedRates) / sizeof(supportedRates[0]); i++)
+  {
+    if (pgm_read_dword(&supportedRates[i]) == rate)
+      return true;
+  }
+  return false;
+}
+
+SerialSpeed::SerialSpeed()
+    : current(BAUD_DEFAULT), next(0), probation(false), since(0), window(0)
+{
+}
+
+void SerialSpeed::begin(uint32_t remembered)
+{
+  if (!baudSupported(remembered))
+    remembered = BAUD_DEFAULT;
+  open(remembered, BAUD_BOOT_CONFIRM_MS);
+}
+
+bool SerialSpeed::apply()
+{
+  if (next == 0)
+    return false;
+
+  uint32_t rate = next;
+  next = 0;
+  serialOut.drain(); // Let the reply finish at the old rate
+  Serial.end();
+  open(rate, BAUD_CONFIRM_MS);
+  return true;
+}
+
+bool SerialSpeed::confirm()
+{
+  if (!probation)
+    return false;
+  probation = false;
+  return true;
+}
+
+bool SerialSpeed::poll()
+{
+  if (!probation || halMillis() - since < window)
+    return false;
+
+  Serial.end();
+  open(BAUD_DEFAULT, 0);
+  return true;
+}
+
+void SerialSpeed::open(uint32_t rate, unsigned long confirmMs)
+{
+  Serial.begin(rate);
+  current = rate;
+  probation = (rate != BAUD_DEFAULT);
+  since = halMillis();
+  window = confirmMs;
+}
@@ -0,0 +1,61 @@
+#include "soft_clock.h"
+#include "hal.h"
+
+// Resyncs this far behind the soft clock hold the time still instead of
+// stepping back (an alarm could otherwise see the same minute twice). A
+// bigger jump is a real clock change and goes through.
+#define SOFT_CLOCK_MAX_HOLD_S 2
+
+// Drift needs a long enough baseline to mean anything
+#define SOFT_CLOCK_MIN_DRIFT_S 60
+
+SoftClock::SoftClock()
+    : lastErrorMs(0), driftPpm(0), syncCount(0), baseSeconds(0), baseMs(0),
+      lastSyncMs(0), floorSeconds(0), baseAligned(false), pending(true),
+      intervalMinutes(SOFT_CLOCK_SYNC_MINUTES)
+{
+}
+
+void SoftClock::sync(uint32_t seconds, unsigned long atMs, bool aligned)
+{
+  uint32_t before = synced() ? now() : 0;
+
+  if (synced())
+  {
+    // Where the soft clock thought we were at atMs, against the RTC
+    uint32_t elapsedS = seconds - baseSeconds;
+    lastErrorMs = (int32_t)(atMs - baseMs) - (int32_t)(elapsedS * 1000UL);
+    if (aligned && baseAligned && elapsedS >= SOFT_CLOCK_MIN_DRIFT_S)
+      driftPpm = lastErrorMs * 1000L / (int32_t)elapsedS;
+  }
+
+  baseSeconds = seconds;
+  baseMs = atMs;
+  baseAligned = aligned;
+  lastSyncMs = halMillis();
+  pending = false;
+  syncCount++;
+
+  uint32_t after = now();
+  floorSeconds = (before > after && before - after <= SOFT_CLOCK_MAX_HOLD_S) ? before : 0;
+}
+
+void SoftClock::syncFailed()
+{
+  lastSyncMs = halMillis();
+  pending = false;
+}
+
+uint32_t SoftClock::now()
+{
+  uint32_t t = baseSeconds + (halMillis() - baseMs) / 1000UL;
+  if (t < floorSeconds)
+    return floorSeconds;
+  floorSeconds = 0; // Caught up
+  return t;
+}
+
+bool SoftClock::needsSync() const
+{
+  return pending || halMillis() - lastSyncMs >= (unsigned long)intervalMinutes * 60000UL;
+}
@@ -0,0 +1,222 @@
+#include "twi.h"
+#include "hal.h"
+#include <util/twi.h>
+
+// ---- Queue: head is on the bus, the rest wait their turn ----
+static TwiTxn *volatile head = NULL;
+static TwiTxn *tail = NULL;
+static uint16_t pos;  // Bytes of head+data written, or bytes read
+static bool reading;  // Past the repeated start
+static volatile uint16_t errors = 0;
+
+// Clear TWINT (go on to the next bus step) with the interrupt enabled
+static inline void twcr(uint8_t extra)
+{
+  TWCR = bit(TWEN) | bit(TWIE) | bit(TWINT) | extra;
+}
+
+// Put the queue head on the bus. Reads without anything to write skip
+// straight to SLA+R.
+static void startHead(uint8_t extra)
+{
+  TwiTxn *t = head;
+  if (!t)
+  {
+    twcr(extra & bit(TWSTO));
+    return;
+  }
+  t->status = TWI_ACTIVE;
+  pos = 0;
+  reading = (t->headLen == 0 && t->dataLen == 0 && t->readLen != 0);
+  twcr(extra | bit(TWSTA));
+}
+
+// End the transaction on the bus and start the next one. stop: send a
+// STOP first (not after a bus error or lost arbitration - the bus isn't
+// ours then).
+static void finish(uint8_t status, bool stop)
+{
+  TwiTxn *t = head;
+  head = t->next;
+  if (!head)
+    tail = NULL;
+  t->next = NULL;
+  if (status != TWI_DONE)
+    errors++;
+  t->status = status;
+  if (t->onDone)
+    t->onDone(*t);
+  startHead(stop ? bit(TWSTO) : 0);
+}
+
+// Next byte to write: head[], then data[]. False when both are done.
+static inline bool nextByte(TwiTxn *t, uint8_t &b)
+{
+  if (pos < t->headLen)
+  {
+    b = t->head[pos++];
+    return true;
+  }
+  uint16_t i = pos - t->headLen;
+  if (i < t->dataLen)
+  {
+    b = t->data[i];
+    pos++;
+    return true;
+  }
+  return false;
+}
+
+ISR(TWI_vect)
+{
+  TwiTxn *t = head;
+  if (!t)
+  {
+    TWCR = bit(TWEN); // Nothing to do - leave TWINT set, interrupt off
+    return;
+  }
+
+  uint8_t b;
+  switch (TW_STATUS)
+  {
+  case TW_START:
+  case TW_REP_START:
+    TWDR = (t->addr << 1) | (reading ? TW_READ : TW_WRITE);
+    twcr(0);
+    break;
+
+  case TW_MT_SLA_ACK:
+  case TW_MT_DATA_ACK:
+    if (nextByte(t, b))
+    {
+      TWDR = b;
+      twcr(0);
+    }
+    else if (t->readLen)
+    {
+      reading = true;
+      pos = 0;
+      twcr(bit(TWSTA)); // Repeated start, keep the bus
+    }
+    else
+    {
+      finish(TWI_DONE, true);
+    }
+    break;
+
+  case TW_MR_SLA_ACK:
+    twcr(t->readLen > 1 ? bit(TWEA) : 0); // NACK the last byte
+    break;
+
+  case TW_MR_DATA_ACK:
+    t->readBuf[pos++] = TWDR;
+    twcr(pos + 1 < t->readLen ? bit(TWEA) : 0);
+    break;
+
+  case TW_MR_DATA_NACK:
+    t->readBuf[pos++] = TWDR;
+    finish(TWI_DONE, true);
+    break;
+
+  case TW_MT_SLA_NACK:
+  case TW_MT_DATA_NACK:
+  case TW_MR_SLA_NACK:
+    finish(TWI_NACK, true);
+    break;
+
+  case TW_MT_ARB_LOST:
+    finish(TWI_ERROR, false);
+    break;
+
+  default: // TW_BUS_ERROR: let go of the lines, then carry on
+    TWCR = bit(TWINT) | bit(TWSTO) | bit(TWEN);
+    finish(TWI_ERROR, false);
+    break;
+  }
+}
+
+void twiBegin()
+{
+  // Internal pull-ups as well, like Wire (the modules have their own)
+  pinMode(SDA, INPUT_PULLUP);
+  pinMode(SCL, INPUT_PULLUP);
+  TWSR = 0; // Prescaler 1
+  TWBR = ((F_CPU / TWI_FREQ) - 16) / 2;
+  TWCR = bit(TWEN) | bit(TWIE);
+}
+
+bool twiSubmit(TwiTxn &txn, bool urgent)
+{
+  if (twiPending(txn))
+    return false;
+  txn.status = TWI_QUEUED;
+  txn.next = NULL;
+
+  uint8_t oldSREG = SREG;
+  cli();
+  if (!head)
+  {
+    head = tail = &txn;
+    while (TWCR & bit(TWSTO))
+      ; // The last STOP is still going out (a few us)
+    startHead(0);
+  }
+  else if (urgent)
+  {
+    txn.next = head->next; // Right behind the one on the bus
+    head->next = &txn;
+    if (tail == head)
+      tail = &txn;
+  }
+  else
+  {
+    tail->next = &txn;
+    tail = &txn;
+  }
+  SREG = oldSREG;
+  return true;
+}
+
+bool twiBusy()
+{
+  return head != NULL;
+}
+
+uint8_t twiWait(TwiTxn &txn)
+{
+  unsigned long start = halMillis();
+  while (twiPending(txn))
+  {
+    if (halMillis() - start < TWI_TIMEOUT_MS)
+      continue;
+
+    // A device is holding the bus (or the interrupt never came): reset
+    // the hardware and fail everything that was waiting
+    uint8_t oldSREG = SREG;
+    cli();
+    TWCR = 0;
+    while (head)
+    {
+      TwiTxn *t = head;
+      head = t->next;
+      t->next = NULL;
+      t->status = TWI_ERROR;
+      errors++;
+      if (t->onDone)
+        t->onDone(*t);
+    }
+    tail = NULL;
+    twiBegin();
+    SREG = oldSREG;
+  }
+  return txn.status;
+}
+
+uint16_t twiErrors()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t n = errors;
+  SREG = oldSREG;
+  return n;
+}